@@ -0,0 +1,227 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+/*
+	Times Query_raycast with the merged chunk rects against the same
+	cast walking every chunk tile by tile, for rays of 4, 16, 64 and
+	256 tiles over terrain of hills, caves and platforms. Rays start
+	in empty tiles, in random directions, and span their length on
+	the longer axis. Both casts have to hit the same points.
+
+	usage: query_bench [rays] [rounds]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+#include "world.h"
+#include "query.h"
+
+#define BENCH_WIDTH  1024
+#define BENCH_HEIGHT 512
+#define BENCH_RECTS_MAX 24	/* QUERY_RECTS_MAX in query.c */
+#define BENCH_APART 0.01f	/* px */
+
+static const size_t BENCH_LENGTHS[] = { 4, 16, 64, 256 };
+
+typedef struct BenchRay {
+	float x;
+	float y;
+	float dx;
+	float dy;
+} BenchRay;
+
+static uint32_t bench_seed = 1;
+
+static uint32_t bench_rand(void)
+{
+	bench_seed = bench_seed * 1103515245u + 12345u;
+	return (bench_seed >> 8) & 0x7FFFFF;
+}
+
+static void bench_fill(World * world, const size_t x1, const size_t y1,
+		       const size_t x2, const size_t y2, const Block block)
+{
+	for (size_t y = y1; y < y2 && y < BENCH_HEIGHT; y++)
+		for (size_t x = x1; x < x2 && x < BENCH_WIDTH; x++)
+			World_set_block(world, x, y, L_BLOCK, block);
+}
+
+/* hills over the lower half, caves carved out, platforms in the air */
+static World bench_world(void)
+{
+	World world = World_new(BENCH_WIDTH, BENCH_HEIGHT);
+	size_t ground = BENCH_HEIGHT / 2;
+	size_t x, y;
+
+	if (world.invalid)
+		return world;
+
+	for (x = 0; x < BENCH_WIDTH; x++) {
+		if (x % 8 == 0 && bench_rand() % 2)
+			ground = bench_rand() % 2 ? ground + 1 : ground - 1;
+
+		bench_fill(&world, x, ground, x + 1, BENCH_HEIGHT, B_DIRT);
+	}
+
+	for (size_t i = 0; i < 300; i++) {
+		x = bench_rand() % BENCH_WIDTH;
+		y = BENCH_HEIGHT / 2 + 8 + bench_rand() % (BENCH_HEIGHT / 2);
+		bench_fill(&world, x, y, x + 4 + bench_rand() % 24,
+			   y + 3 + bench_rand() % 6, B_NONE);
+	}
+
+	for (size_t i = 0; i < 200; i++) {
+		x = bench_rand() % BENCH_WIDTH;
+		y = bench_rand() % (BENCH_HEIGHT / 2 - 16);
+		bench_fill(&world, x, y, x + 3 + bench_rand() % 12, y + 1,
+			   B_DIRT);
+	}
+
+	World_rebuild_solid(&world);
+
+	return world;
+}
+
+static void bench_rays(const World * world, BenchRay * rays,
+		       const size_t count, const size_t length)
+{
+	const float span = (float) length * BLOCK_SIZE;
+	size_t x, y;
+	float dx, dy, longer;
+
+	for (size_t i = 0; i < count; i++) {
+		do {
+			x = bench_rand() % BENCH_WIDTH;
+			y = bench_rand() % BENCH_HEIGHT;
+		} while (World_is_solid(world, x, y));
+
+		do {
+			dx = (float) (bench_rand() % 2001) - 1000.0f;
+			dy = (float) (bench_rand() % 2001) - 1000.0f;
+		} while (dx == 0.0f && dy == 0.0f);
+
+		longer = (dx < 0.0f ? -dx : dx) > (dy < 0.0f ? -dy : dy) ?
+		    (dx < 0.0f ? -dx : dx) : (dy < 0.0f ? -dy : dy);
+		rays[i].x = (x + bench_rand() % 1000 / 1000.0f) * BLOCK_SIZE;
+		rays[i].y = (y + bench_rand() % 1000 / 1000.0f) * BLOCK_SIZE;
+		rays[i].dx = dx / longer * span;
+		rays[i].dy = dy / longer * span;
+	}
+}
+
+/* contact points further apart than the rounding of the two casts */
+static bool bench_apart(const float a, const float b)
+{
+	return a - b > BENCH_APART || b - a > BENCH_APART;
+}
+
+/* nanoseconds per ray */
+static double bench_cast(const World * world, const BenchRay * rays,
+			 QueryHit * hits, const size_t count,
+			 const size_t rounds)
+{
+	Uint64 begin = SDL_GetPerformanceCounter();
+
+	for (size_t r = 0; r < rounds; r++)
+		for (size_t i = 0; i < count; i++)
+			hits[i] = Query_raycast(world, rays[i].x, rays[i].y,
+						rays[i].dx, rays[i].dy);
+
+	return (double) (SDL_GetPerformanceCounter() - begin) * 1e9 /
+	    SDL_GetPerformanceFrequency() / (count * rounds);
+}
+
+int main(int argc, char **argv)
+{
+	size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+	size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : 3;
+	World world;
+	size_t chunks, rects = 0, dense = 0, solid = 0, differ;
+	uint16_t *rect_count;
+	BenchRay *rays;
+	QueryHit *hits, *tile_hits;
+	double rect_ns, tile_ns;
+
+	if (count == 0 || rounds == 0) {
+		fprintf(stderr, "usage: %s [rays] [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	world = bench_world();
+	chunks = world.chunks_w * world.chunks_h;
+	rect_count = malloc(chunks * sizeof(uint16_t));
+	rays = malloc(count * sizeof(BenchRay));
+	hits = malloc(count * sizeof(QueryHit));
+	tile_hits = malloc(count * sizeof(QueryHit));
+
+	if (world.invalid || rect_count == NULL || rays == NULL ||
+	    hits == NULL || tile_hits == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	memcpy(rect_count, world.rect_count, chunks * sizeof(uint16_t));
+
+	for (size_t c = 0; c < chunks; c++) {
+		rects += rect_count[c];
+		dense += rect_count[c] > BENCH_RECTS_MAX;
+	}
+
+	for (size_t y = 0; y < BENCH_HEIGHT; y++)
+		for (size_t x = 0; x < BENCH_WIDTH; x++)
+			solid += World_is_solid(&world, x, y);
+
+	printf("%zu solid tiles in %zu rects, %zu of %zu chunks dense\n",
+	       solid, rects, dense, chunks);
+	printf("%zu rays, %zu rounds, ns per ray\n", count, rounds);
+
+	for (size_t l = 0; l < sizeof(BENCH_LENGTHS) / sizeof(size_t); l++) {
+		bench_rays(&world, rays, count, BENCH_LENGTHS[l]);
+		rect_ns = bench_cast(&world, rays, hits, count, rounds);
+
+		// without rects every chunk is walked tile by tile
+		for (size_t c = 0; c < chunks; c++)
+			world.rect_count[c] = WORLD_RECTS_NONE;
+
+		tile_ns = bench_cast(&world, rays, tile_hits, count, rounds);
+		memcpy(world.rect_count, rect_count, chunks * sizeof(uint16_t));
+
+		differ = 0;
+
+		// on a tile corner the two may name different tiles
+		for (size_t i = 0; i < count; i++)
+			differ += hits[i].hit != tile_hits[i].hit ||
+			    bench_apart(hits[i].x, tile_hits[i].x) ||
+			    bench_apart(hits[i].y, tile_hits[i].y);
+
+		printf("%3zu tiles: tiles %6.1f, rects %6.1f, %zu hits "
+		       "differ\n", BENCH_LENGTHS[l], tile_ns, rect_ns,
+		       differ);
+	}
+
+	free(tile_hits);
+	free(hits);
+	free(rays);
+	free(rect_count);
+	World_clear(&world);
+
+	return 0;
+}
@@ -0,0 +1,285 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+/*
+	Frame time of the tile layers on a real renderer at 640x480,
+	1920x1080 and 3840x2160: batched into one SDL_RenderGeometry call,
+	one copy per tile, and through the ChunkCache with a cap of
+	cache MiB. Each frame is drawn into a target texture of that size
+	and read back by one pixel, so the time includes the renderer
+	finishing the frame. The camera pans BENCH_PAN pixels per frame.
+
+	usage: render_bench [frames] [cache MiB] [renderer driver name]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL.h>
+#include "atlas.h"
+#include "cache.h"
+#include "render.h"
+#include "world.h"
+
+#define BENCH_WIDTH  1024
+#define BENCH_HEIGHT 512
+#define BENCH_PAN    8
+
+static const SDL_Point BENCH_SIZES[] = {
+	{640, 480},
+	{1920, 1080},
+	{3840, 2160},
+};
+
+static uint32_t bench_seed = 1;
+
+static uint32_t bench_rand(void)
+{
+	bench_seed = bench_seed * 1103515245u + 12345u;
+	return (bench_seed >> 8) & 0x7FFFFF;
+}
+
+/* walls behind layered terrain with caves, ground line at half height */
+static World bench_world(void)
+{
+	World world = World_new(BENCH_WIDTH, BENCH_HEIGHT);
+	Block block;
+
+	if (world.invalid)
+		return world;
+
+	for (size_t y = BENCH_HEIGHT / 2 - 8; y < BENCH_HEIGHT; y++) {
+		for (size_t x = 0; x < BENCH_WIDTH; x++) {
+			World_set_block(&world, x, y, L_WALL,
+					1 + bench_rand() % B_LAST);
+
+			if (y < BENCH_HEIGHT / 2 || bench_rand() % 6 == 0)
+				continue;
+
+			block = 1 + bench_rand() % B_LAST;
+			World_set_block(&world, x, y, L_BLOCK, block);
+		}
+	}
+
+	return world;
+}
+
+/* one flat colour per sprite, the content does not matter here */
+static SDL_Surface *bench_sprite(const Uint8 r, const Uint8 g, const Uint8 b)
+{
+	SDL_Surface *sprite;
+
+	sprite = SDL_CreateRGBSurfaceWithFormat(0, BLOCK_SIZE, BLOCK_SIZE, 32,
+						SDL_PIXELFORMAT_RGBA32);
+
+	if (sprite != NULL)
+		SDL_FillRect(sprite, NULL, SDL_MapRGB(sprite->format, r, g, b));
+
+	return sprite;
+}
+
+static Atlas bench_atlas(SDL_Renderer * renderer)
+{
+	SDL_Surface *surfaces[ATLAS_SPRITES] = { NULL };
+	Atlas atlas;
+
+	for (size_t i = 1; i <= B_LAST; i++) {
+		surfaces[i] = bench_sprite(40 * i, 255 - 40 * i, 128);
+		surfaces[B_LAST + 1 + i] = bench_sprite(20 * i, 64, 128);
+	}
+
+	atlas = Atlas_new(renderer, surfaces, ATLAS_SPRITES);
+
+	for (size_t i = 0; i < ATLAS_SPRITES; i++)
+		if (surfaces[i] != NULL)
+			SDL_FreeSurface(surfaces[i]);
+
+	return atlas;
+}
+
+/*
+	Milliseconds per frame of walls and blocks over the ground line,
+	through the cache if not NULL. renders counts chunks it drew.
+*/
+static double bench_frames(SDL_Renderer * renderer, SDL_Texture * target,
+			   TileBatch * batch, ChunkCache * cache,
+			   World * world, const SDL_Point * size,
+			   const size_t frames, RenderStats * stats,
+			   size_t *renders)
+{
+	const int pan = BENCH_WIDTH * BLOCK_SIZE - size->x;
+	const SDL_Rect probe = { 0, 0, 1, 1 };
+	SDL_Rect camera = {
+		.y = BENCH_HEIGHT / 2 * BLOCK_SIZE - size->y / 2,
+		.w = size->x,
+		.h = size->y,
+	};
+	size_t x1, y1, x2, y2;
+	uint32_t pixel;
+	Uint64 begin;
+
+	*renders = 0;
+	SDL_SetRenderTarget(renderer, target);
+	begin = SDL_GetPerformanceCounter();
+
+	for (size_t f = 0; f < frames; f++) {
+		// pan sideways, so every frame has other tiles
+		camera.x = (int)(f * BENCH_PAN % (size_t) pan);
+
+		RenderStats_frame(stats);
+		SDL_SetRenderDrawColor(renderer, 155, 219, 245, 255);
+		SDL_RenderClear(renderer);
+
+		if (cache != NULL) {
+			ChunkCache_draw(cache, world, &camera, batch, stats);
+			*renders += cache->rendered;
+		} else {
+			x1 = camera.x / BLOCK_SIZE;
+			y1 = camera.y / BLOCK_SIZE;
+			x2 = (camera.x + camera.w) / BLOCK_SIZE + 1;
+			y2 = (camera.y + camera.h) / BLOCK_SIZE + 1;
+			TileBatch_add_tiles(batch, world, x1, y1,
+					    x2 < BENCH_WIDTH ? x2 : BENCH_WIDTH,
+					    y2 < BENCH_HEIGHT ? y2 :
+					    BENCH_HEIGHT,
+					    x1 * BLOCK_SIZE - camera.x,
+					    y1 * BLOCK_SIZE - camera.y, true,
+					    true);
+			TileBatch_draw(batch, renderer, stats);
+		}
+
+		// wait for the renderer to finish the frame
+		SDL_RenderReadPixels(renderer, &probe, SDL_PIXELFORMAT_RGBA32,
+				     &pixel, sizeof(pixel));
+	}
+
+	SDL_SetRenderTarget(renderer, NULL);
+
+	return (double)(SDL_GetPerformanceCounter() - begin) * 1000.0 /
+	    SDL_GetPerformanceFrequency() / frames;
+}
+
+int main(int argc, char **argv)
+{
+	size_t frames = argc > 1 ? strtoul(argv[1], NULL, 10) : 300;
+	size_t cache_mib = argc > 2 ? strtoul(argv[2], NULL, 10) : 64;
+	SDL_Window *window;
+	SDL_Renderer *renderer;
+	SDL_RendererInfo info;
+	SDL_Texture *target;
+	World world;
+	Atlas atlas;
+	TileBatch batch;
+	ChunkCache cache;
+	RenderStats stats;
+	double ms;
+	size_t renders;
+	const SDL_Point *size;
+
+	if (frames == 0) {
+		fprintf(stderr, "usage: %s [frames] [cache MiB] "
+			"[renderer driver name]\n", argv[0]);
+		return 1;
+	}
+
+	if (argc > 3)
+		SDL_SetHint(SDL_HINT_RENDER_DRIVER, argv[3]);
+
+	if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+		fprintf(stderr, "%s\n", SDL_GetError());
+		return 1;
+	}
+
+	window = SDL_CreateWindow("render_bench", SDL_WINDOWPOS_UNDEFINED,
+				  SDL_WINDOWPOS_UNDEFINED, 64, 64,
+				  SDL_WINDOW_HIDDEN);
+	renderer = window == NULL ? NULL :
+	    SDL_CreateRenderer(window, -1, SDL_RENDERER_TARGETTEXTURE);
+
+	if (renderer == NULL) {
+		fprintf(stderr, "%s\n", SDL_GetError());
+		SDL_Quit();
+		return 1;
+	}
+
+	SDL_GetRendererInfo(renderer, &info);
+	world = bench_world();
+	atlas = bench_atlas(renderer);
+	batch = TileBatch_new(&atlas, 0);
+
+	if (world.invalid || atlas.invalid || batch.invalid) {
+		fprintf(stderr, "setup failed\n");
+		SDL_Quit();
+		return 1;
+	}
+
+	printf("renderer %s, %zu frames, cache %zu MiB, ms per frame\n",
+	       info.name, frames, cache_mib);
+
+	for (size_t s = 0; s < sizeof(BENCH_SIZES) / sizeof(SDL_Point); s++) {
+		size = &BENCH_SIZES[s];
+		target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+					   SDL_TEXTUREACCESS_TARGET, size->x,
+					   size->y);
+
+		if (target == NULL) {
+			fprintf(stderr, "%ix%i: %s\n", size->x, size->y,
+				SDL_GetError());
+			continue;
+		}
+
+		batch.copies = false;
+		ms = bench_frames(renderer, target, &batch, NULL, &world,
+				  size, frames, &stats, &renders);
+		printf("%4ix%-4i %6u quads  batched %7.3f (%u calls)",
+		       size->x, size->y, stats.quads, ms, stats.calls);
+
+		batch.copies = true;
+		ms = bench_frames(renderer, target, &batch, NULL, &world,
+				  size, frames, &stats, &renders);
+		printf("  per tile %7.3f (%u calls)", ms, stats.calls);
+
+		// the cache draws chunks through the batch as the game does
+		batch.copies = false;
+		cache = ChunkCache_new(renderer, &world,
+				       &(SDL_Rect) {0, 0, size->x, size->y},
+				       cache_mib * 1024 * 1024);
+
+		if (cache.invalid) {
+			printf("  cached: too few textures\n");
+		} else {
+			ms = bench_frames(renderer, target, &batch, &cache,
+					  &world, size, frames, &stats,
+					  &renders);
+			printf("  cached %7.3f (%zu chunk renders)\n", ms,
+			       renders);
+			ChunkCache_clear(&cache);
+		}
+
+		SDL_DestroyTexture(target);
+	}
+
+	TileBatch_clear(&batch);
+	Atlas_clear(&atlas);
+	World_clear(&world);
+	SDL_DestroyRenderer(renderer);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+
+	return 0;
+}
@@ -0,0 +1,296 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+/*
+	Times Physics_step on 1 to N threads over the same world of walkers
+	and the cost of waking the pool for a step with next to no work,
+	which is what PHYSICS_MIN_PER_THREAD has to outweigh.
+	Then sleeping and the level of detail, in float and fixed point:
+	a resting world with and without sleeping, and a world of walkers
+	ticked every step and every BENCH_LOD_INTERVAL steps off the view.
+
+	usage: sim_bench [entities] [steps] [threads]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+#include "world.h"
+#include "physics.h"
+#include "spatial.h"
+
+#define BENCH_WIDTH  4096
+#define BENCH_HEIGHT 512
+#define BENCH_RATE   120
+#define BENCH_DT     (1.0f / BENCH_RATE)
+#define BENCH_LOD_DISTANCE 32	/* blocks */
+#define BENCH_LOD_INTERVAL 4
+#define BENCH_SETTLE 600	/* steps until dropped entities rest */
+
+typedef struct BenchRun {
+	double physics;		/* ms per step */
+	double total;		/* with the hash rebuild and wake */
+	size_t asleep;		/* after the last step */
+} BenchRun;
+
+static uint32_t bench_seed = 1;
+
+static uint32_t bench_rand(void)
+{
+	bench_seed = bench_seed * 1103515245u + 12345u;
+	return (bench_seed >> 8) & 0x7FFFFF;
+}
+
+/* solid lower half, a bumpy surface and entities dropped above it */
+static World bench_world(const size_t entities, const bool walking)
+{
+	World world;
+
+	world = World_alloc(BENCH_WIDTH, BENCH_HEIGHT, entities, true);
+
+	if (world.invalid)
+		return world;
+
+	bench_seed = 1;
+
+	for (size_t y = BENCH_HEIGHT / 2; y < BENCH_HEIGHT; y++)
+		for (size_t x = 0; x < BENCH_WIDTH; x++)
+			World_set_block(&world, x, y, L_BLOCK, B_DIRT);
+
+	for (size_t i = 0; i < BENCH_WIDTH * 4; i++)
+		World_set_block(&world, bench_rand() % BENCH_WIDTH,
+				BENCH_HEIGHT / 2 - 1 - bench_rand() % 4,
+				L_BLOCK, B_DIRT);
+
+	World_rebuild_solid(&world);
+
+	for (size_t i = 0; i < entities; i++) {
+		world.entities[i].id = E_PLAYER;
+		world.entities[i].rect.w = DATA_ENTITIES[E_PLAYER].width;
+		world.entities[i].rect.h = DATA_ENTITIES[E_PLAYER].height;
+		world.entities[i].rect.x =
+		    bench_rand() % ((BENCH_WIDTH - 8) * 32);
+		world.entities[i].rect.y = bench_rand() % (BENCH_HEIGHT * 16);
+		world.entities[i].velocity_x = walking ?
+		    (float)(bench_rand() % 400) - 200.0f : 0.0f;
+	}
+
+	return world;
+}
+
+/* milliseconds per step, every entity stays awake */
+static double bench_steps(const World * world, const size_t steps,
+			  PhysicsPool * pool)
+{
+	Physics phys = Physics_new(world, 0);
+	SpatialHash hash = SpatialHash_new(world, world->ent_count);
+	Uint64 start, total = 0;
+
+	if (phys.invalid || hash.invalid) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	SpatialHash_build(&hash, &phys);
+
+	for (size_t s = 0; s < steps; s++) {
+		memset(phys.asleep, 0, phys.len);
+
+		start = SDL_GetPerformanceCounter();
+		Physics_step(&phys, world, BENCH_DT, NULL, hash.order, pool);
+		total += SDL_GetPerformanceCounter() - start;
+
+		SpatialHash_build(&hash, &phys);
+	}
+
+	SpatialHash_clear(&hash);
+	Physics_clear(&phys);
+
+	return (double) total * 1000.0 / SDL_GetPerformanceFrequency() /
+	    steps;
+}
+
+/*
+	Steps as the game runs them: the step with a view, the hash rebuild
+	and waking sleepers touched by movers. Unless rest is set every
+	entity is woken before each step, as if none could sleep. Walkers
+	are pushed left and right every step. The first BENCH_SETTLE steps
+	are not timed, dropped entities land and fall asleep in them.
+*/
+static BenchRun bench_game(const World * world, const size_t steps,
+			   const int32_t rate, const bool rest,
+			   const bool walk, const uint8_t lod_interval)
+{
+	const SG_FRect view = { 1000.0f, 7000.0f, 640.0f, 480.0f };
+	Physics phys = Physics_new(world, rate);
+	SpatialHash hash = SpatialHash_new(world, world->ent_count);
+	BenchRun run = { 0.0, 0.0, 0 };
+	Uint64 start, physics = 0, total = 0;
+
+	if (phys.invalid || hash.invalid) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	phys.lod_distance = BENCH_LOD_DISTANCE * BLOCK_SIZE;
+	phys.lod_interval = lod_interval;
+	SpatialHash_build(&hash, &phys);
+
+	for (size_t s = 0; s < BENCH_SETTLE + steps; s++) {
+		for (size_t i = 0; walk && i < phys.len; i++)
+			Physics_accelerate(&phys, i, (i + s / 60) % 2 ?
+					   384.0f : -384.0f, 0.0f, BENCH_DT);
+
+		if (!rest)
+			memset(phys.asleep, 0, phys.len);
+
+		start = SDL_GetPerformanceCounter();
+		Physics_step(&phys, world, BENCH_DT, &view, hash.order, NULL);
+
+		if (s >= BENCH_SETTLE)
+			physics += SDL_GetPerformanceCounter() - start;
+
+		SpatialHash_build(&hash, &phys);
+
+		if (rest)
+			SpatialHash_wake(&hash, &phys);
+
+		if (s >= BENCH_SETTLE)
+			total += SDL_GetPerformanceCounter() - start;
+	}
+
+	for (size_t i = 0; i < phys.len; i++)
+		run.asleep += phys.asleep[i] != 0;
+
+	run.physics = (double)physics * 1000.0 /
+	    SDL_GetPerformanceFrequency() / steps;
+	run.total = (double)total * 1000.0 /
+	    SDL_GetPerformanceFrequency() / steps;
+
+	SpatialHash_clear(&hash);
+	Physics_clear(&phys);
+
+	return run;
+}
+
+/* resting and walking worlds with sleeping and the level of detail */
+static void bench_sleep(const size_t entities, const size_t steps,
+			const int32_t rate)
+{
+	const char *mode = rate > 0 ? "fixed" : "float";
+	World world = bench_world(entities, false);
+	BenchRun awake, asleep, every, lod;
+
+	if (world.invalid || (rate > 0 && !Physics_fixed_fits(&world))) {
+		fprintf(stderr, "no %s world\n", mode);
+		World_clear(&world);
+		return;
+	}
+
+	awake = bench_game(&world, steps, rate, false, false, 1);
+	asleep = bench_game(&world, steps, rate, true, false, 1);
+	printf("[%s] resting world: %.3f ms/step awake, %.3f with sleep "
+	       "(%zu/%zu asleep)\n", mode, awake.total, asleep.total,
+	       asleep.asleep, entities);
+
+	every = bench_game(&world, steps, rate, true, true, 1);
+	lod = bench_game(&world, steps, rate, true, true,
+			 BENCH_LOD_INTERVAL);
+	printf("[%s] walking world: physics %.3f -> %.3f ms/step, "
+	       "total %.3f -> %.3f (lod_interval 1 -> %i)\n", mode,
+	       every.physics, lod.physics, every.total, lod.total,
+	       BENCH_LOD_INTERVAL);
+
+	World_clear(&world);
+}
+
+int main(int argc, char **argv)
+{
+	size_t entities = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+	size_t steps = argc > 2 ? strtoul(argv[2], NULL, 10) : 200;
+	size_t threads = argc > 3 ? strtoul(argv[3], NULL, 10) :
+	    (size_t) SDL_GetCPUCount();
+	World world, tiny;
+	PhysicsPool pool;
+	double single, ms, entity_us, wake_us;
+
+	if (entities == 0 || steps == 0 || threads == 0) {
+		fprintf(stderr, "usage: %s [entities] [steps] [threads]\n",
+			argv[0]);
+		return 1;
+	}
+
+	world = bench_world(entities, true);
+	tiny = bench_world(threads, true);
+
+	if (world.invalid || tiny.invalid) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	printf("%zu entities, %zu steps, %d cpus\n", entities, steps,
+	       SDL_GetCPUCount());
+
+	single = bench_steps(&world, steps, NULL);
+	entity_us = single * 1000.0 / entities;
+	printf("threads  1: %8.3f ms/step  %.4f us/entity\n", single,
+	       entity_us);
+
+	for (size_t t = 2; t <= threads; t++) {
+		pool = PhysicsPool_new(t);
+
+		if (pool.invalid) {
+			fprintf(stderr, "no pool of %zu threads\n", t);
+			break;
+		}
+
+		ms = bench_steps(&world, steps, &pool);
+		printf("threads %2zu: %8.3f ms/step  x%.2f\n", t, ms,
+		       single / ms);
+		PhysicsPool_clear(&pool);
+	}
+
+	if (threads < 2)
+		goto sleep;
+
+	// one entity per thread, nearly all of it is waking the pool
+	pool = PhysicsPool_new(threads);
+
+	if (pool.invalid)
+		goto sleep;
+
+	pool.min_part = 1;
+	wake_us = (bench_steps(&tiny, steps * 10, &pool) -
+		   bench_steps(&tiny, steps * 10, NULL)) * 1000.0;
+	PhysicsPool_clear(&pool);
+
+	printf("waking %zu threads: %.2f us/step, worth it from about "
+	       "%.0f entities per thread\n", threads, wake_us,
+	       wake_us / entity_us);
+
+ sleep:
+	World_clear(&tiny);
+	World_clear(&world);
+
+	bench_sleep(entities, steps, 0);
+	bench_sleep(entities, steps, BENCH_RATE);
+
+	return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+/*
+	Times Entity_move_x and Entity_move_y, which sweep over the solid
+	mask, against the test and revert loop they replaced, for short,
+	medium and long steps over the same terrain.
+
+	usage: sweep_bench [entities] [rounds]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL.h>
+#include <SG_physics.h>
+#include "world.h"
+#include "entity.h"
+
+#define BENCH_WIDTH  4096
+#define BENCH_HEIGHT 1024
+
+static const float BENCH_STEPS[] = { 3.0f, 40.0f, 600.0f };
+
+static uint32_t bench_seed = 1;
+
+static uint32_t bench_rand(void)
+{
+	bench_seed = bench_seed * 1103515245u + 12345u;
+	return (bench_seed >> 8) & 0x7FFFFF;
+}
+
+/* terrain below half height with caves, and floating blocks above */
+static World bench_world(void)
+{
+	World world = World_new(BENCH_WIDTH, BENCH_HEIGHT);
+
+	if (world.invalid)
+		return world;
+
+	for (size_t y = BENCH_HEIGHT / 2; y < BENCH_HEIGHT; y++)
+		for (size_t x = 0; x < BENCH_WIDTH; x++)
+			if (bench_rand() % 8 != 0)
+				World_set_block(&world, x, y, L_BLOCK,
+						B_DIRT);
+
+	for (size_t i = 0; i < 20000; i++)
+		World_set_block(&world, bench_rand() % BENCH_WIDTH,
+				bench_rand() % (BENCH_HEIGHT / 2), L_BLOCK,
+				B_DIRT);
+
+	return world;
+}
+
+/* the loop before the solid mask and the sweep: move, test, revert */
+static bool_t old_move(SG_Entity * ent, float *pos, float *velocity,
+		       float distance, World * world)
+{
+	bool_t collision = FALSE;
+	int_fast32_t x1, y1, x2, y2;
+	SG_FRect block_hitbox;
+
+	*pos += distance;
+
+	x1 = ent->rect.x / BLOCK_SIZE;
+	y1 = ent->rect.y / BLOCK_SIZE;
+	x2 = (ent->rect.x + ent->rect.w) / BLOCK_SIZE + 1;
+	y2 = (ent->rect.y + ent->rect.h) / BLOCK_SIZE + 1;
+
+	x1 = x1 < 0 ? 0 : x1 > BENCH_WIDTH - 1 ? BENCH_WIDTH - 1 : x1;
+	y1 = y1 < 0 ? 0 : y1 > BENCH_HEIGHT - 1 ? BENCH_HEIGHT - 1 : y1;
+	x2 = x2 < 0 ? 0 : x2 > BENCH_WIDTH - 1 ? BENCH_WIDTH - 1 : x2;
+	y2 = y2 < 0 ? 0 : y2 > BENCH_HEIGHT - 1 ? BENCH_HEIGHT - 1 : y2;
+
+	block_hitbox.w = BLOCK_SIZE;
+	block_hitbox.h = BLOCK_SIZE;
+
+	for (int_fast32_t x = x1; x <= x2; x++) {
+		for (int_fast32_t y = y1; y <= y2; y++) {
+			if (World_get_block(world, x, y, L_BLOCK) == B_NONE)
+				continue;
+
+			block_hitbox.x = x * BLOCK_SIZE;
+			block_hitbox.y = y * BLOCK_SIZE;
+
+			if (SG_box_within_box(&ent->rect, &block_hitbox)) {
+				collision = TRUE;
+				*pos -= distance;
+				*velocity = 0.0f;
+			}
+		}
+	}
+
+	return collision;
+}
+
+static void old_move_x(SG_Entity * ent, float x_distance, World * world)
+{
+	old_move(ent, &ent->rect.x, &ent->velocity_x, x_distance, world);
+}
+
+static void old_move_y(SG_Entity * ent, float y_distance, World * world)
+{
+	ent->grounded = old_move(ent, &ent->rect.y, &ent->velocity_y,
+				 y_distance, world) && y_distance > 0.0f;
+}
+
+/* nanoseconds per x and y move, every entity walks back and forth */
+static double bench_moves(const SG_Entity * start, SG_Entity * ents,
+			  const size_t count, const size_t rounds,
+			  const float step, World * world, const bool old)
+{
+	Uint64 begin;
+	float dir;
+
+	for (size_t i = 0; i < count; i++)
+		ents[i] = start[i];
+
+	begin = SDL_GetPerformanceCounter();
+
+	for (size_t r = 0; r < rounds; r++) {
+		dir = (r / 16) % 2 ? -step : step;
+
+		for (size_t i = 0; i < count; i++) {
+			if (old) {
+				old_move_x(&ents[i], dir, world);
+				old_move_y(&ents[i], step, world);
+			} else {
+				Entity_move_x(&ents[i], dir, world);
+				Entity_move_y(&ents[i], step, world);
+			}
+		}
+	}
+
+	return (double) (SDL_GetPerformanceCounter() - begin) * 1e9 /
+	    SDL_GetPerformanceFrequency() / (count * rounds);
+}
+
+int main(int argc, char **argv)
+{
+	size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000;
+	size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : 100;
+	World world;
+	SG_Entity *start, *ents;
+	double old_ns, sweep_ns;
+
+	if (count == 0 || rounds == 0) {
+		fprintf(stderr, "usage: %s [entities] [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	world = bench_world();
+	start = calloc(count, sizeof(SG_Entity));
+	ents = calloc(count, sizeof(SG_Entity));
+
+	if (world.invalid || start == NULL || ents == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		start[i].id = E_PLAYER;
+		start[i].rect.w = DATA_ENTITIES[E_PLAYER].width;
+		start[i].rect.h = DATA_ENTITIES[E_PLAYER].height;
+		start[i].rect.x = bench_rand() % ((BENCH_WIDTH - 4) * 32);
+		start[i].rect.y = bench_rand() % (BENCH_HEIGHT * 32);
+	}
+
+	printf("%zu entities, %zu rounds, ns per x and y move\n", count,
+	       rounds);
+
+	for (size_t s = 0; s < sizeof(BENCH_STEPS) / sizeof(float); s++) {
+		old_ns = bench_moves(start, ents, count, rounds,
+				     BENCH_STEPS[s], &world, true);
+		sweep_ns = bench_moves(start, ents, count, rounds,
+				       BENCH_STEPS[s], &world, false);
+		printf("%4.0f px steps: old loop %7.1f, sweep %7.1f\n",
+		       BENCH_STEPS[s], old_ns, sweep_ns);
+	}
+
+	free(ents);
+	free(start);
+	World_clear(&world);
+
+	return 0;
+}
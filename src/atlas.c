@@ -0,0 +1,200 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#include <stdlib.h>
+#include "atlas.h"
+
+/* copies part src of a sprite to x, y of the atlas surface */
+static void Atlas_blit(SDL_Surface * sprite, SDL_Surface * surface,
+		       const int src_x, const int src_y, const int w,
+		       const int h, const int x, const int y)
+{
+	SDL_Rect src = {.x = src_x,.y = src_y,.w = w,.h = h };
+	SDL_Rect dst = {.x = x,.y = y,.w = w,.h = h };
+
+	SDL_BlitSurface(sprite, &src, surface, &dst);
+}
+
+/* a sprite at rect, its border rows and columns repeated into padding */
+static void Atlas_place(SDL_Surface * sprite, SDL_Surface * surface,
+			const SDL_Rect * rect)
+{
+	const int x2 = rect->x + rect->w - 1;
+	const int y2 = rect->y + rect->h - 1;
+	SDL_BlendMode blend;
+
+	// copy pixels as they are, alpha included
+	SDL_GetSurfaceBlendMode(sprite, &blend);
+	SDL_SetSurfaceBlendMode(sprite, SDL_BLENDMODE_NONE);
+
+	Atlas_blit(sprite, surface, 0, 0, rect->w, rect->h, rect->x, rect->y);
+
+	for (int i = 1; i <= ATLAS_PADDING; i++) {
+		Atlas_blit(sprite, surface, 0, 0, rect->w, 1, rect->x,
+			   rect->y - i);
+		Atlas_blit(sprite, surface, 0, rect->h - 1, rect->w, 1,
+			   rect->x, y2 + i);
+		Atlas_blit(sprite, surface, 0, 0, 1, rect->h, rect->x - i,
+			   rect->y);
+		Atlas_blit(sprite, surface, rect->w - 1, 0, 1, rect->h,
+			   x2 + i, rect->y);
+
+		for (int j = 1; j <= ATLAS_PADDING; j++) {
+			Atlas_blit(sprite, surface, 0, 0, 1, 1,
+				   rect->x - i, rect->y - j);
+			Atlas_blit(sprite, surface, rect->w - 1, 0, 1, 1,
+				   x2 + i, rect->y - j);
+			Atlas_blit(sprite, surface, 0, rect->h - 1, 1, 1,
+				   rect->x - i, y2 + j);
+			Atlas_blit(sprite, surface, rect->w - 1, rect->h - 1,
+				   1, 1, x2 + i, y2 + j);
+		}
+	}
+
+	SDL_SetSurfaceBlendMode(sprite, blend);
+}
+
+/*
+	Shelf packing: sprites go left to right in order of height, a
+	sprite that does not fit opens a new shelf below the tallest of
+	the last one. The width is the power of two that makes a square of
+	the sprite area, or the widest sprite.
+*/
+static void Atlas_pack(Atlas * atlas, SDL_Surface * const *surfaces,
+		       size_t *order, size_t count)
+{
+	const int pad = ATLAS_PADDING * 2;
+	size_t area = 0;
+	int x = 0, y = 0, shelf = 0;
+	size_t k;
+
+	// tallest first, there are only a few sprites
+	for (size_t i = 1; i < count; i++) {
+		k = order[i];
+
+		for (size_t j = i;
+		     j > 0 && surfaces[order[j - 1]]->h < surfaces[k]->h; j--) {
+			order[j] = order[j - 1];
+			order[j - 1] = k;
+		}
+	}
+
+	atlas->w = 1;
+
+	for (size_t i = 0; i < count; i++) {
+		k = order[i];
+		area += (size_t) (surfaces[k]->w + pad) *
+		    (surfaces[k]->h + pad);
+
+		while (atlas->w < surfaces[k]->w + pad)
+			atlas->w *= 2;
+	}
+
+	while ((size_t) atlas->w * atlas->w < area)
+		atlas->w *= 2;
+
+	for (size_t i = 0; i < count; i++) {
+		k = order[i];
+
+		if (x + surfaces[k]->w + pad > atlas->w) {
+			y += shelf;
+			x = 0;
+			shelf = 0;
+		}
+
+		atlas->rects[k].x = x + ATLAS_PADDING;
+		atlas->rects[k].y = y + ATLAS_PADDING;
+		atlas->rects[k].w = surfaces[k]->w;
+		atlas->rects[k].h = surfaces[k]->h;
+
+		x += surfaces[k]->w + pad;
+
+		if (surfaces[k]->h + pad > shelf)
+			shelf = surfaces[k]->h + pad;
+	}
+
+	atlas->h = y + shelf;
+}
+
+/* NULL surfaces get an empty rect */
+Atlas Atlas_new(SDL_Renderer * renderer, SDL_Surface * const *surfaces,
+		const size_t len)
+{
+	Atlas atlas = {
+		.invalid = false,
+		.texture = NULL,
+		.len = len,
+	};
+	SDL_Surface *surface;
+	size_t *order = malloc(len * sizeof(size_t));
+	size_t count = 0;
+
+	atlas.rects = calloc(len, sizeof(SDL_Rect));
+
+	if (order == NULL || atlas.rects == NULL) {
+		free(order);
+		Atlas_clear(&atlas);
+		atlas.invalid = true;
+		return atlas;
+	}
+
+	for (size_t i = 0; i < len; i++)
+		if (surfaces[i] != NULL)
+			order[count++] = i;
+
+	Atlas_pack(&atlas, surfaces, order, count);
+
+	surface = SDL_CreateRGBSurfaceWithFormat(0, atlas.w,
+						 atlas.h > 0 ? atlas.h : 1,
+						 32, SDL_PIXELFORMAT_RGBA32);
+
+	if (surface == NULL) {
+		free(order);
+		Atlas_clear(&atlas);
+		atlas.invalid = true;
+		return atlas;
+	}
+
+	for (size_t i = 0; i < count; i++)
+		Atlas_place(surfaces[order[i]], surface,
+			    &atlas.rects[order[i]]);
+
+	atlas.texture = SDL_CreateTextureFromSurface(renderer, surface);
+	SDL_FreeSurface(surface);
+	free(order);
+
+	if (atlas.texture == NULL) {
+		Atlas_clear(&atlas);
+		atlas.invalid = true;
+	}
+
+	return atlas;
+}
+
+void Atlas_clear(Atlas * atlas)
+{
+	if (atlas->texture != NULL)
+		SDL_DestroyTexture(atlas->texture);
+
+	free(atlas->rects);
+
+	atlas->texture = NULL;
+	atlas->rects = NULL;
+	atlas->len = 0;
+}
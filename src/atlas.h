@@ -0,0 +1,69 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <SDL_render.h>
+#include "block.h"
+#include "entity.h"
+#include "world.h"
+
+/*
+	All sprites of the game in one texture, drawn with source rects, so
+	consecutive copies share a texture.
+	Sprites are packed onto shelves, tallest first. Each is surrounded
+	by ATLAS_PADDING pixels repeating its border, filtering at scaled
+	draws never reaches a neighbour.
+	The game atlas holds the blocks, their walls and the entities, in
+	that order (see Atlas_tile, Atlas_entity).
+*/
+#define ATLAS_PADDING 1
+#define ATLAS_SPRITES (2 * (B_LAST + 1) + E_LAST + 1)
+
+typedef struct Atlas {
+	bool invalid;
+	SDL_Texture *texture;
+	int w;
+	int h;
+	size_t len;
+	SDL_Rect *rects;	/* per sprite, 0 wide if it has none */
+} Atlas;
+
+Atlas Atlas_new(SDL_Renderer * renderer, SDL_Surface * const *surfaces,
+		const size_t len);
+
+/* source rect of a block on a layer */
+static inline const SDL_Rect *Atlas_tile(const Atlas * atlas,
+					 const Layer layer, const Block block)
+{
+	return &atlas->rects[layer == L_BLOCK ? block : B_LAST + 1 + block];
+}
+
+static inline const SDL_Rect *Atlas_entity(const Atlas * atlas,
+					   const Entity entity)
+{
+	return &atlas->rects[2 * (B_LAST + 1) + entity];
+}
+
+void Atlas_clear(Atlas * atlas);
+
+#endif				// ATLAS_H
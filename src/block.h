@@ -21,6 +21,7 @@
 #define BLOCK_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 static const int_fast32_t BLOCK_SIZE = 32;
 
@@ -33,4 +34,11 @@ typedef enum Block {
 	B_LAST = B_STONE,
 } Block;
 
+/* blocks whose sprite covers the whole tile, the wall behind is hidden */
+static const bool BLOCK_OPAQUE[B_LAST + 1] = {
+	[B_NONE] = false,
+	[B_DIRT] = true,
+	[B_STONE] = true,
+};
+
 #endif				/* BLOCK_H */
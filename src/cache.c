@@ -0,0 +1,257 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#include <stdlib.h>
+#include <SM_log.h>
+#include "block.h"
+#include "cache.h"
+
+#define CACHE_CHUNK_PX (BLOCK_SIZE * WORLD_CHUNK_SIZE)
+
+// target textures hold premultiplied colors, see ChunkCache_render
+static SDL_BlendMode cache_blend(void)
+{
+	return SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE,
+					  SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+					  SDL_BLENDOPERATION_ADD,
+					  SDL_BLENDFACTOR_ONE,
+					  SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+					  SDL_BLENDOPERATION_ADD);
+}
+
+/* first chunk of a pixel span, spans before the world start at 0 */
+static size_t chunk_of(const int px)
+{
+	return px < 0 ? 0 : (size_t) px / CACHE_CHUNK_PX;
+}
+
+ChunkCache ChunkCache_new(SDL_Renderer * renderer, const World * world,
+			  const SDL_Rect * camera, const size_t memory_cap)
+{
+	ChunkCache cache = {
+		.invalid = false,
+		.renderer = renderer,
+		.cap = memory_cap / (CACHE_CHUNK_PX * CACHE_CHUNK_PX * 4),
+	};
+	// chunks a camera overlaps at most
+	const size_t visible =
+	    ((camera->w + CACHE_CHUNK_PX - 1) / CACHE_CHUNK_PX + 1) *
+	    ((camera->h + CACHE_CHUNK_PX - 1) / CACHE_CHUNK_PX + 1);
+
+	// fewer textures than on screen would render chunks every frame
+	if (!SDL_RenderTargetSupported(renderer) || cache.cap < visible) {
+		cache.invalid = true;
+		return cache;
+	}
+
+	if (cache.cap > world->chunks_w * world->chunks_h)
+		cache.cap = world->chunks_w * world->chunks_h;
+
+	cache.entry = calloc(world->chunks_w * world->chunks_h,
+			     sizeof(uint32_t));
+	cache.entries = calloc(cache.cap, sizeof(ChunkCacheEntry));
+
+	if (cache.entry == NULL || cache.entries == NULL) {
+		ChunkCache_clear(&cache);
+		cache.invalid = true;
+		return cache;
+	}
+
+	for (size_t i = 0; i < cache.cap; i++)
+		cache.entries[i].chunk = SIZE_MAX;
+
+	return cache;
+}
+
+/* walls and blocks of a chunk, its top left corner at x, y */
+static void ChunkCache_draw_tiles(SDL_Renderer * renderer,
+				  const World * world, const size_t chunk,
+				  const int x, const int y,
+				  TileBatch * batch, RenderStats * stats)
+{
+	const size_t x1 = (chunk % world->chunks_w) << WORLD_CHUNK_SHIFT;
+	const size_t y1 = (chunk / world->chunks_w) << WORLD_CHUNK_SHIFT;
+	size_t x2 = x1 + WORLD_CHUNK_SIZE;
+	size_t y2 = y1 + WORLD_CHUNK_SIZE;
+
+	if (x2 > world->width)
+		x2 = world->width;
+
+	if (y2 > world->height)
+		y2 = world->height;
+
+	TileBatch_add_tiles(batch, world, x1, y1, x2, y2, x, y, true, true);
+	TileBatch_draw(batch, renderer, stats);
+}
+
+/* entry for a chunk, reusing the one drawn longest ago if none is free */
+static ChunkCacheEntry *ChunkCache_take(ChunkCache * cache,
+					const size_t chunk)
+{
+	ChunkCacheEntry *entry = NULL;
+
+	for (size_t i = 0; i < cache->cap; i++) {
+		if (cache->entries[i].chunk == SIZE_MAX) {
+			entry = &cache->entries[i];
+			break;
+		}
+
+		if (cache->entries[i].drawn != cache->frame &&
+		    (entry == NULL ||
+		     cache->frame - cache->entries[i].drawn >
+		     cache->frame - entry->drawn))
+			entry = &cache->entries[i];
+	}
+
+	if (entry == NULL)
+		return NULL;
+
+	if (entry->chunk != SIZE_MAX)
+		cache->entry[entry->chunk] = 0;
+
+	if (entry->texture == NULL) {
+		entry->texture =
+		    SDL_CreateTexture(cache->renderer,
+				      SDL_PIXELFORMAT_RGBA8888,
+				      SDL_TEXTUREACCESS_TARGET,
+				      CACHE_CHUNK_PX, CACHE_CHUNK_PX);
+
+		if (entry->texture == NULL) {
+			entry->chunk = SIZE_MAX;
+			return NULL;
+		}
+
+		if (SDL_SetTextureBlendMode(entry->texture,
+					    cache_blend()) != 0)
+			SDL_SetTextureBlendMode(entry->texture,
+						SDL_BLENDMODE_BLEND);
+	}
+
+	entry->chunk = chunk;
+	cache->entry[chunk] = entry - cache->entries + 1;
+
+	return entry;
+}
+
+/*
+	Draws a chunk into its texture. Blending onto a transparent target
+	leaves premultiplied colors, cache_blend puts them on screen as
+	the tiles would have been. The target set before is restored.
+*/
+static bool ChunkCache_render(ChunkCache * cache, const World * world,
+			      const ChunkCacheEntry * entry,
+			      TileBatch * batch, RenderStats * stats)
+{
+	SDL_Texture *target = SDL_GetRenderTarget(cache->renderer);
+
+	if (SDL_SetRenderTarget(cache->renderer, entry->texture) != 0)
+		return false;
+
+	SDL_SetRenderDrawColor(cache->renderer, 0, 0, 0, 0);
+	SDL_RenderClear(cache->renderer);
+	ChunkCache_draw_tiles(cache->renderer, world, entry->chunk, 0, 0,
+			      batch, stats);
+	SDL_SetRenderTarget(cache->renderer, target);
+	cache->rendered++;
+
+	return true;
+}
+
+void ChunkCache_draw(ChunkCache * cache, World * world,
+		     const SDL_Rect * camera, TileBatch * batch,
+		     RenderStats * stats)
+{
+	const size_t x1 = chunk_of(camera->x);
+	const size_t y1 = chunk_of(camera->y);
+	size_t x2 = chunk_of(camera->x + camera->w - 1);
+	size_t y2 = chunk_of(camera->y + camera->h - 1);
+	ChunkCacheEntry *entry;
+	SDL_Rect dst = {.w = CACHE_CHUNK_PX,.h = CACHE_CHUNK_PX };
+	size_t chunk;
+
+	if (x2 >= world->chunks_w)
+		x2 = world->chunks_w - 1;
+
+	if (y2 >= world->chunks_h)
+		y2 = world->chunks_h - 1;
+
+	cache->frame++;
+	cache->rendered = 0;
+
+	for (size_t y = y1; y <= y2; y++) {
+		for (size_t x = x1; x <= x2; x++) {
+			chunk = y * world->chunks_w + x;
+			dst.x = x * CACHE_CHUNK_PX - camera->x;
+			dst.y = y * CACHE_CHUNK_PX - camera->y;
+
+			if (cache->entry[chunk] != 0) {
+				entry = &cache->entries[cache->entry[chunk] -
+							1];
+			} else {
+				entry = ChunkCache_take(cache, chunk);
+				world->flags[chunk] |= CF_REDRAW;
+			}
+
+			if (entry != NULL &&
+			    (world->flags[chunk] & CF_REDRAW) &&
+			    ChunkCache_render(cache, world, entry, batch,
+					      stats))
+				world->flags[chunk] &= ~CF_REDRAW;
+
+			// without a texture the tiles go straight on screen
+			if (entry == NULL ||
+			    (world->flags[chunk] & CF_REDRAW)) {
+				ChunkCache_draw_tiles(cache->renderer, world,
+						      chunk, dst.x, dst.y,
+						      batch, stats);
+				continue;
+			}
+
+			entry->drawn = cache->frame;
+			Render_copy(cache->renderer, stats, entry->texture,
+				    NULL, &dst);
+		}
+	}
+}
+
+void ChunkCache_reset(ChunkCache * cache)
+{
+	for (size_t i = 0; i < cache->cap; i++) {
+		if (cache->entries[i].chunk == SIZE_MAX)
+			continue;
+
+		cache->entry[cache->entries[i].chunk] = 0;
+		cache->entries[i].chunk = SIZE_MAX;
+	}
+}
+
+void ChunkCache_clear(ChunkCache * cache)
+{
+	if (cache->entries != NULL)
+		for (size_t i = 0; i < cache->cap; i++)
+			if (cache->entries[i].texture != NULL)
+				SDL_DestroyTexture(cache->entries[i].texture);
+
+	free(cache->entry);
+	free(cache->entries);
+
+	cache->entry = NULL;
+	cache->entries = NULL;
+	cache->cap = 0;
+}
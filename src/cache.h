@@ -0,0 +1,67 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <SDL_render.h>
+#include "render.h"
+#include "world.h"
+
+/*
+	Keeps visible chunks as render target textures, walls and blocks
+	composited once, so a frame blits a few chunk textures instead of
+	drawing every tile.
+	A chunk is drawn again when its CF_REDRAW flag is set (edits,
+	streaming). Textures are reused least recently drawn first, cap
+	bounds their count. Target contents get lost on some renderers,
+	ChunkCache_reset drops them all.
+*/
+
+typedef struct ChunkCacheEntry {
+	size_t chunk;		/* SIZE_MAX if free */
+	uint32_t drawn;		/* frame of the last draw */
+	SDL_Texture *texture;
+} ChunkCacheEntry;
+
+typedef struct ChunkCache {
+	bool invalid;
+	SDL_Renderer *renderer;
+	uint32_t *entry;	/* per chunk, index in entries + 1, 0 = none */
+	ChunkCacheEntry *entries;
+	size_t cap;
+	uint32_t frame;
+	size_t rendered;	/* chunks rendered by the last draw */
+} ChunkCache;
+
+ChunkCache ChunkCache_new(SDL_Renderer * renderer, const World * world,
+			  const SDL_Rect * camera, const size_t memory_cap);
+
+void ChunkCache_draw(ChunkCache * cache, World * world,
+		     const SDL_Rect * camera, TileBatch * batch,
+		     RenderStats * stats);
+
+void ChunkCache_reset(ChunkCache * cache);
+
+void ChunkCache_clear(ChunkCache * cache);
+
+#endif				// CACHE_H
@@ -0,0 +1,214 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#include <stdlib.h>
+#include "canvas.h"
+
+Canvas Canvas_new(SDL_Renderer * renderer, const int x, const int y,
+		  const int w, const int h)
+{
+	Canvas canvas = {
+		.invalid = false,
+		.renderer = renderer,
+		.targets = {NULL, NULL},
+		.front = 0,
+		.x = x,
+		.y = y,
+		.w = w,
+		.h = h,
+		.len = 0,
+		.present = false,
+	};
+
+	if (SDL_RenderTargetSupported(renderer)) {
+		for (size_t i = 0; i < 2; i++) {
+			canvas.targets[i] =
+			    SDL_CreateTexture(renderer,
+					      SDL_PIXELFORMAT_RGBA8888,
+					      SDL_TEXTUREACCESS_TARGET, w, h);
+
+			// contents replace what is on screen
+			if (canvas.targets[i] != NULL)
+				SDL_SetTextureBlendMode(canvas.targets[i],
+							SDL_BLENDMODE_NONE);
+		}
+	}
+
+	if (canvas.targets[0] == NULL || canvas.targets[1] == NULL) {
+		Canvas_clear(&canvas);
+		canvas.invalid = true;
+	}
+
+	Canvas_dirty_all(&canvas);
+
+	return canvas;
+}
+
+void Canvas_dirty(Canvas * canvas, const SDL_Rect * area)
+{
+	const SDL_Rect view = {
+		.x = canvas->x,
+		.y = canvas->y,
+		.w = canvas->w,
+		.h = canvas->h,
+	};
+	SDL_Rect visible;
+	const SDL_Rect *r;
+
+	if (!SDL_IntersectRect(area, &view, &visible))
+		return;
+
+	if (canvas->invalid) {
+		Canvas_dirty_all(canvas);
+		return;
+	}
+
+	for (size_t i = 0; i < canvas->len; i++) {
+		r = &canvas->dirty[i];
+
+		if (visible.x >= r->x && visible.y >= r->y &&
+		    visible.x + visible.w <= r->x + r->w &&
+		    visible.y + visible.h <= r->y + r->h)
+			return;
+	}
+
+	if (canvas->len < CANVAS_DIRTY_MAX) {
+		canvas->dirty[canvas->len++] = visible;
+		return;
+	}
+
+	for (size_t i = 1; i < canvas->len; i++)
+		SDL_UnionRect(&canvas->dirty[0], &canvas->dirty[i],
+			      &canvas->dirty[0]);
+
+	SDL_UnionRect(&canvas->dirty[0], &visible, &canvas->dirty[0]);
+	canvas->len = 1;
+}
+
+void Canvas_dirty_all(Canvas * canvas)
+{
+	canvas->dirty[0].x = canvas->x;
+	canvas->dirty[0].y = canvas->y;
+	canvas->dirty[0].w = canvas->w;
+	canvas->dirty[0].h = canvas->h;
+	canvas->len = 1;
+}
+
+/* something drawn over the canvas changed, the frame needs a present */
+void Canvas_touch(Canvas * canvas)
+{
+	if (canvas->invalid)
+		Canvas_dirty_all(canvas);
+
+	canvas->present = true;
+}
+
+/* moves the canvas to camera position x, y */
+void Canvas_scroll(Canvas * canvas, const int x, const int y)
+{
+	const int dx = x - canvas->x;
+	const int dy = y - canvas->y;
+	SDL_Rect shifted = {.x = -dx,.y = -dy,.w = canvas->w,.h = canvas->h };
+	SDL_Rect strip;
+
+	if (dx == 0 && dy == 0)
+		return;
+
+	canvas->x = x;
+	canvas->y = y;
+
+	if (canvas->invalid || abs(dx) >= canvas->w || abs(dy) >= canvas->h ||
+	    SDL_SetRenderTarget(canvas->renderer,
+				canvas->targets[!canvas->front]) != 0) {
+		Canvas_dirty_all(canvas);
+		return;
+	}
+
+	SDL_RenderCopy(canvas->renderer, canvas->targets[canvas->front], NULL,
+		       &shifted);
+	SDL_SetRenderTarget(canvas->renderer, NULL);
+	canvas->front = !canvas->front;
+
+	// uncovered columns, then rows
+	if (dx != 0) {
+		strip.x = dx > 0 ? x + canvas->w - dx : x;
+		strip.y = y;
+		strip.w = abs(dx);
+		strip.h = canvas->h;
+		Canvas_dirty(canvas, &strip);
+	}
+
+	if (dy != 0) {
+		strip.x = x;
+		strip.y = dy > 0 ? y + canvas->h - dy : y;
+		strip.w = canvas->w;
+		strip.h = abs(dy);
+		Canvas_dirty(canvas, &strip);
+	}
+}
+
+/*
+	False if nothing changed, the frame can be skipped. Otherwise the
+	dirty areas (see Canvas_area) are to be drawn, onto the canvas, and
+	Canvas_end puts it on screen.
+*/
+bool Canvas_begin(Canvas * canvas)
+{
+	if (canvas->len == 0)
+		return canvas->present;
+
+	if (!canvas->invalid &&
+	    SDL_SetRenderTarget(canvas->renderer,
+				canvas->targets[canvas->front]) != 0) {
+		Canvas_clear(canvas);
+		canvas->invalid = true;
+		Canvas_dirty_all(canvas);
+	}
+
+	return true;
+}
+
+void Canvas_end(Canvas * canvas)
+{
+	SDL_RenderSetClipRect(canvas->renderer, NULL);
+
+	if (!canvas->invalid) {
+		SDL_SetRenderTarget(canvas->renderer, NULL);
+		SDL_RenderCopy(canvas->renderer,
+			       canvas->targets[canvas->front], NULL, NULL);
+	}
+
+	canvas->len = 0;
+	canvas->present = false;
+}
+
+void Canvas_reset(Canvas * canvas)
+{
+	Canvas_dirty_all(canvas);
+}
+
+void Canvas_clear(Canvas * canvas)
+{
+	for (size_t i = 0; i < 2; i++) {
+		if (canvas->targets[i] != NULL)
+			SDL_DestroyTexture(canvas->targets[i]);
+
+		canvas->targets[i] = NULL;
+	}
+}
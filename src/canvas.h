@@ -0,0 +1,85 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <SDL_render.h>
+
+/*
+	A screen sized render target kept between frames, so only areas
+	that changed get drawn again and a frame without changes is not
+	presented at all.
+	Dirty areas are in world pixels, x, y is the camera the contents
+	were drawn for. Scrolling copies the old contents shifted into the
+	second target, only the strips it uncovers become dirty. Past
+	CANVAS_DIRTY_MAX areas they merge into their bounding box.
+	Without target support (invalid) every change redraws the whole
+	screen, as the back buffer is undefined after a present. Target
+	contents get lost on some renderers, Canvas_reset redraws them.
+*/
+#define CANVAS_DIRTY_MAX 16
+
+typedef struct Canvas {
+	bool invalid;
+	SDL_Renderer *renderer;
+	SDL_Texture *targets[2];
+	size_t front;
+	int x;
+	int y;
+	int w;
+	int h;
+	size_t len;
+	SDL_Rect dirty[CANVAS_DIRTY_MAX];
+	bool present;
+} Canvas;
+
+Canvas Canvas_new(SDL_Renderer * renderer, const int x, const int y,
+		  const int w, const int h);
+
+void Canvas_dirty(Canvas * canvas, const SDL_Rect * area);
+
+void Canvas_dirty_all(Canvas * canvas);
+
+void Canvas_touch(Canvas * canvas);
+
+void Canvas_scroll(Canvas * canvas, const int x, const int y);
+
+bool Canvas_begin(Canvas * canvas);
+
+/* dirty area i on screen, between Canvas_begin and Canvas_end */
+static inline SDL_Rect Canvas_area(const Canvas * canvas, const size_t i)
+{
+	SDL_Rect area = canvas->dirty[i];
+
+	area.x -= canvas->x;
+	area.y -= canvas->y;
+
+	return area;
+}
+
+void Canvas_end(Canvas * canvas);
+
+void Canvas_reset(Canvas * canvas);
+
+void Canvas_clear(Canvas * canvas);
+
+#endif				// CANVAS_H
@@ -0,0 +1,291 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <SM_log.h>
+#include <SM_string.h>
+#include "path.h"
+#include "catalog.h"
+
+static const size_t CATALOG_STD_CAP = 64;
+
+typedef struct CatalogFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t entry_size;
+	uint32_t count;
+} CatalogFileHeader;
+
+/* nanoseconds where the platform has them, a save rarely changes the size */
+static int64_t stat_mtime(const struct stat *st)
+{
+#ifdef _WIN32
+	return (int64_t) st->st_mtime * 1000000000;
+#else
+	return (int64_t) st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+static int entry_compare(const void *a, const void *b)
+{
+	return strcmp(((const CatalogEntry *)a)->name,
+		      ((const CatalogEntry *)b)->name);
+}
+
+static int name_compare(const void *name, const void *entry)
+{
+	return strcmp((const char *)name, ((const CatalogEntry *)entry)->name);
+}
+
+/* an unusable cache reads as empty, it only costs a rescan */
+static Catalog read_cache(const char *path)
+{
+	Catalog cache = {.invalid = false };
+	CatalogFileHeader header;
+	long file_size;
+	FILE *f = fopen(path, "rb");
+
+	if (f == NULL)
+		return cache;
+
+	// count has to fit into the rest of the file, so its size can not wrap
+	if (fseek(f, 0, SEEK_END) != 0 || (file_size = ftell(f)) < 0 ||
+	    fseek(f, 0, SEEK_SET) != 0 ||
+	    fread(&header, sizeof(header), 1, f) != 1 ||
+	    memcmp(header.magic, CATALOG_MAGIC, sizeof(header.magic)) != 0 ||
+	    header.version != CATALOG_VERSION ||
+	    header.entry_size != sizeof(CatalogEntry) || header.count == 0 ||
+	    ((size_t) file_size - sizeof(header)) / sizeof(CatalogEntry) <
+	    header.count)
+		goto end;
+
+	cache.entries = malloc(header.count * sizeof(CatalogEntry));
+
+	if (cache.entries == NULL)
+		goto end;
+
+	if (fread(cache.entries, sizeof(CatalogEntry), header.count, f) !=
+	    header.count)
+		goto fail;
+
+	// names are compared as strings
+	for (size_t i = 0; i < header.count; i++)
+		if (cache.entries[i].name[CATALOG_NAME_MAX - 1] != '\0')
+			goto fail;
+
+	cache.len = header.count;
+
+ end:
+	fclose(f);
+	return cache;
+
+ fail:
+	free(cache.entries);
+	cache.entries = NULL;
+	fclose(f);
+	return cache;
+}
+
+static bool write_cache(const Catalog * catalog, const char *path)
+{
+	SM_String tmppath = SM_String_new(8);
+	CatalogFileHeader header = {
+		.version = CATALOG_VERSION,
+		.entry_size = sizeof(CatalogEntry),
+		.count = catalog->len,
+	};
+	bool result;
+	FILE *f;
+
+	memcpy(header.magic, CATALOG_MAGIC, sizeof(header.magic));
+
+	SM_String_copy_cstr(&tmppath, path);
+	SM_String_append_cstr(&tmppath, ".tmp");
+
+	f = fopen(tmppath.str, "wb");
+
+	if (f == NULL) {
+		SM_String_clear(&tmppath);
+		return false;
+	}
+
+	result = fwrite(&header, sizeof(header), 1, f) == 1 &&
+	    fwrite(catalog->entries, sizeof(CatalogEntry), catalog->len,
+		   f) == catalog->len;
+
+	if (fclose(f) != 0)
+		result = false;
+
+	if (result) {
+#ifdef _WIN32
+		remove(path);
+#endif
+		result = rename(tmppath.str, path) == 0;
+	}
+
+	if (!result)
+		remove(tmppath.str);
+
+	SM_String_clear(&tmppath);
+	return result;
+}
+
+/* reads the world header, worlds in the old format only keep their name */
+static void describe(CatalogEntry * entry, const char *path)
+{
+	WorldFileHeader header;
+
+	if (!WorldFile_describe(path, &header, entry->thumbnail)) {
+		memset(entry->thumbnail, 0, sizeof(entry->thumbnail));
+		return;
+	}
+
+	entry->version = header.version;
+	entry->width = header.width;
+	entry->height = header.height;
+	entry->ent_count = header.ent_count;
+	entry->created = header.created;
+	entry->modified = header.modified != 0 ? header.modified :
+	    entry->mtime / 1000000000;
+}
+
+Catalog Catalog_load(void)
+{
+	Catalog catalog = {.invalid = true };
+	Catalog cache = {.invalid = true };
+	SM_String dirpath = SM_String_new(8);
+	SM_String cachepath = SM_String_new(8);
+	SM_String path = SM_String_new(8);
+	const size_t ext_len = strlen(FILETYPE_WORLD) + 1;
+	size_t cap = 0;
+	size_t name_len;
+	CatalogEntry *entries;
+	CatalogEntry *entry;
+	const CatalogEntry *cached;
+	struct dirent *file;
+	struct stat st;
+	DIR *dir;
+
+	if (get_world_path(&dirpath) != 0 ||
+	    get_catalog_path(&cachepath) != 0)
+		goto end;
+
+	cache = read_cache(cachepath.str);
+	dir = opendir(dirpath.str);
+
+	if (dir == NULL)
+		goto end;
+
+	catalog.invalid = false;
+
+	while ((file = readdir(dir)) != NULL) {
+		// only "<name>.wld", saves in progress end in ".tmp"
+		name_len = strlen(file->d_name);
+
+		if (name_len <= ext_len ||
+		    name_len - ext_len >= CATALOG_NAME_MAX ||
+		    file->d_name[name_len - ext_len] != '.' ||
+		    strcmp(&file->d_name[name_len - ext_len + 1],
+			   FILETYPE_WORLD) != 0)
+			continue;
+
+		SM_String_copy_cstr(&path, dirpath.str);
+		SM_String_append_cstr(&path, file->d_name);
+
+		if (stat(path.str, &st) != 0 || !S_ISREG(st.st_mode))
+			continue;
+
+		if (catalog.len == cap) {
+			cap = cap == 0 ? CATALOG_STD_CAP : cap * 2;
+			entries = realloc(catalog.entries,
+					  cap * sizeof(CatalogEntry));
+
+			if (entries == NULL) {
+				catalog.invalid = true;
+				break;
+			}
+
+			catalog.entries = entries;
+		}
+
+		entry = &catalog.entries[catalog.len++];
+		memset(entry, 0, sizeof(*entry));
+		memcpy(entry->name, file->d_name, name_len - ext_len);
+		entry->mtime = stat_mtime(&st);
+		entry->size = st.st_size;
+
+		// unchanged files keep their cached description
+		cached = cache.len == 0 ? NULL :
+		    bsearch(entry->name, cache.entries, cache.len,
+			    sizeof(CatalogEntry), name_compare);
+
+		if (cached != NULL && cached->mtime == entry->mtime &&
+		    cached->size == entry->size) {
+			*entry = *cached;
+		} else {
+			describe(entry, path.str);
+			catalog.described++;
+		}
+	}
+
+	closedir(dir);
+
+	if (catalog.invalid) {
+		Catalog_clear(&catalog);
+		goto end;
+	}
+
+	if (catalog.len > 0)
+		qsort(catalog.entries, catalog.len, sizeof(CatalogEntry),
+		      entry_compare);
+
+	if ((catalog.described > 0 || catalog.len != cache.len) &&
+	    !write_cache(&catalog, cachepath.str))
+		SM_log_warn("World catalog could not be saved.");
+
+ end:
+	Catalog_clear(&cache);
+	SM_String_clear(&dirpath);
+	SM_String_clear(&cachepath);
+	SM_String_clear(&path);
+	return catalog;
+}
+
+const CatalogEntry *Catalog_find(const Catalog * catalog, const char *name)
+{
+	if (catalog->len == 0)
+		return NULL;
+
+	return bsearch(name, catalog->entries, catalog->len,
+		       sizeof(CatalogEntry), name_compare);
+}
+
+void Catalog_clear(Catalog * catalog)
+{
+	free(catalog->entries);
+
+	catalog->entries = NULL;
+	catalog->len = 0;
+}
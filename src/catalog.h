@@ -0,0 +1,65 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "worldfile.h"
+
+/*
+	Index of the worlds directory, cached next to the worlds.
+	Loading the catalog only stats every world file, headers are read
+	again for files whose mtime or size changed since the last load.
+	Worlds in the old format are listed by name with version 0.
+*/
+#define CATALOG_NAME_MAX 64
+#define CATALOG_VERSION 1
+
+static const char CATALOG_MAGIC[4] = { '2', 'D', 'W', 'C' };
+
+typedef struct CatalogEntry {
+	char name[CATALOG_NAME_MAX];
+	int64_t mtime;		/* ns */
+	uint64_t size;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t ent_count;
+	int64_t created;
+	int64_t modified;
+	uint8_t thumbnail[WORLDFILE_THUMB_BYTES];
+} CatalogEntry;
+
+typedef struct Catalog {
+	bool invalid;
+	size_t len;
+	CatalogEntry *entries;	/* sorted by name */
+	size_t described;	/* headers read by the last load */
+} Catalog;
+
+Catalog Catalog_load(void);
+
+const CatalogEntry *Catalog_find(const Catalog * catalog, const char *name);
+
+void Catalog_clear(Catalog * catalog);
+
+#endif				// CATALOG_H
@@ -31,6 +31,20 @@ Config Config_new(void)
 		.gfx_window_w = CFG_STD_GFX_WINDOW_W,
 		.gfx_window_h = CFG_STD_GFX_WINDOW_H,
 		.gfx_window_fullscreen = CFG_STD_GFX_WINDOW_FULLSCREEN,
+		.gfx_chunk_cache = CFG_STD_GFX_CHUNK_CACHE,
+		.gfx_frame_mode = CFG_STD_GFX_FRAME_MODE,
+		.gfx_frame_cap = CFG_STD_GFX_FRAME_CAP,
+		.gfx_tile_batch = CFG_STD_GFX_TILE_BATCH,
+		.world_compression = CFG_STD_WORLD_COMPRESSION,
+		.world_stream_radius = CFG_STD_WORLD_STREAM_RADIUS,
+		.world_stream_cap = CFG_STD_WORLD_STREAM_CAP,
+		.world_packed = CFG_STD_WORLD_PACKED,
+		.sim_rate = CFG_STD_SIM_RATE,
+		.sim_max_steps = CFG_STD_SIM_MAX_STEPS,
+		.sim_threads = CFG_STD_SIM_THREADS,
+		.sim_fixed = CFG_STD_SIM_FIXED,
+		.sim_lod_distance = CFG_STD_SIM_LOD_DISTANCE,
+		.sim_lod_interval = CFG_STD_SIM_LOD_INTERVAL,
 	};
 
 	return cfg;
@@ -84,6 +98,78 @@ void Config_load(Config * cfg)
 			cfg->gfx_window_fullscreen =
 			    strtol(dict.data[i].value.str, NULL, 10);
 
+		else if (SM_strequal
+			 (dict.data[i].key.str, CFG_SETTING_GFX_CHUNK_CACHE))
+			cfg->gfx_chunk_cache =
+			    strtol(dict.data[i].value.str, NULL, 10);
+
+		else if (SM_strequal
+			 (dict.data[i].key.str, CFG_SETTING_GFX_FRAME_MODE))
+			cfg->gfx_frame_mode =
+			    strtol(dict.data[i].value.str, NULL, 10);
+
+		else if (SM_strequal
+			 (dict.data[i].key.str, CFG_SETTING_GFX_FRAME_CAP))
+			cfg->gfx_frame_cap =
+			    strtol(dict.data[i].value.str, NULL, 10);
+
+		else if (SM_strequal
+			 (dict.data[i].key.str, CFG_SETTING_GFX_TILE_BATCH))
+			cfg->gfx_tile_batch =
+			    strtol(dict.data[i].value.str, NULL, 10);
+
+		// world
+		else if (SM_strequal
+			 (dict.data[i].key.str, CFG_SETTING_WORLD_COMPRESSION))
+			cfg->world_compression =
+			    strtol(dict.data[i].value.str, NULL, 10);
+
+		else if (SM_strequal
+			 (dict.data[i].key.str, CFG_SETTING_WORLD_STREAM_RADIUS))
+			cfg->world_stream_radius =
+			    strtol(dict.data[i].value.str, NULL, 10);
+
+		else if (SM_strequal
+			 (dict.data[i].key.str, CFG_SETTING_WORLD_STREAM_CAP))
+			cfg->world_stream_cap =
+			    strtol(dict.data[i].value.str, NULL, 10);
+
+		else if (SM_strequal
+			 (dict.data[i].key.str, CFG_SETTING_WORLD_PACKED))
+			cfg->world_packed =
+			    strtol(dict.data[i].value.str, NULL, 10);
+
+		// simulation
+		else if (SM_strequal
+			 (dict.data[i].key.str, CFG_SETTING_SIM_RATE))
+			cfg->sim_rate =
+			    strtol(dict.data[i].value.str, NULL, 10);
+
+		else if (SM_strequal
+			 (dict.data[i].key.str, CFG_SETTING_SIM_MAX_STEPS))
+			cfg->sim_max_steps =
+			    strtol(dict.data[i].value.str, NULL, 10);
+
+		else if (SM_strequal
+			 (dict.data[i].key.str, CFG_SETTING_SIM_THREADS))
+			cfg->sim_threads =
+			    strtol(dict.data[i].value.str, NULL, 10);
+
+		else if (SM_strequal
+			 (dict.data[i].key.str, CFG_SETTING_SIM_FIXED))
+			cfg->sim_fixed =
+			    strtol(dict.data[i].value.str, NULL, 10);
+
+		else if (SM_strequal
+			 (dict.data[i].key.str, CFG_SETTING_SIM_LOD_DISTANCE))
+			cfg->sim_lod_distance =
+			    strtol(dict.data[i].value.str, NULL, 10);
+
+		else if (SM_strequal
+			 (dict.data[i].key.str, CFG_SETTING_SIM_LOD_INTERVAL))
+			cfg->sim_lod_interval =
+			    strtol(dict.data[i].value.str, NULL, 10);
+
 		// unknown option
 		else {
 			SM_String_copy_cstr(&msg, "Unknown config setting \"");
@@ -122,6 +208,34 @@ void Config_save(Config * cfg)
 	SM_Dict_add(&dict, CFG_SETTING_GFX_WINDOW_H, temp);
 	sprintf(temp, "%i", cfg->gfx_window_fullscreen);
 	SM_Dict_add(&dict, CFG_SETTING_GFX_WINDOW_FULLSCREEN, temp);
+	sprintf(temp, "%i", cfg->gfx_chunk_cache);
+	SM_Dict_add(&dict, CFG_SETTING_GFX_CHUNK_CACHE, temp);
+	sprintf(temp, "%i", cfg->gfx_frame_mode);
+	SM_Dict_add(&dict, CFG_SETTING_GFX_FRAME_MODE, temp);
+	sprintf(temp, "%i", cfg->gfx_frame_cap);
+	SM_Dict_add(&dict, CFG_SETTING_GFX_FRAME_CAP, temp);
+	sprintf(temp, "%i", cfg->gfx_tile_batch);
+	SM_Dict_add(&dict, CFG_SETTING_GFX_TILE_BATCH, temp);
+	sprintf(temp, "%i", cfg->world_compression);
+	SM_Dict_add(&dict, CFG_SETTING_WORLD_COMPRESSION, temp);
+	sprintf(temp, "%i", cfg->world_stream_radius);
+	SM_Dict_add(&dict, CFG_SETTING_WORLD_STREAM_RADIUS, temp);
+	sprintf(temp, "%i", cfg->world_stream_cap);
+	SM_Dict_add(&dict, CFG_SETTING_WORLD_STREAM_CAP, temp);
+	sprintf(temp, "%i", cfg->world_packed);
+	SM_Dict_add(&dict, CFG_SETTING_WORLD_PACKED, temp);
+	sprintf(temp, "%i", cfg->sim_rate);
+	SM_Dict_add(&dict, CFG_SETTING_SIM_RATE, temp);
+	sprintf(temp, "%i", cfg->sim_max_steps);
+	SM_Dict_add(&dict, CFG_SETTING_SIM_MAX_STEPS, temp);
+	sprintf(temp, "%i", cfg->sim_threads);
+	SM_Dict_add(&dict, CFG_SETTING_SIM_THREADS, temp);
+	sprintf(temp, "%i", cfg->sim_fixed);
+	SM_Dict_add(&dict, CFG_SETTING_SIM_FIXED, temp);
+	sprintf(temp, "%i", cfg->sim_lod_distance);
+	SM_Dict_add(&dict, CFG_SETTING_SIM_LOD_DISTANCE, temp);
+	sprintf(temp, "%i", cfg->sim_lod_interval);
+	SM_Dict_add(&dict, CFG_SETTING_SIM_LOD_INTERVAL, temp);
 
 	// save
 	if (!SM_Dict_write(&dict, filepath.str))
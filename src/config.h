@@ -29,12 +29,40 @@ static const char CFG_SETTING_GFX_WINDOW_Y[] = "gfx_window_y";
 static const char CFG_SETTING_GFX_WINDOW_W[] = "gfx_window_w";
 static const char CFG_SETTING_GFX_WINDOW_H[] = "gfx_window_h";
 static const char CFG_SETTING_GFX_WINDOW_FULLSCREEN[] = "gfx_window_fullscreen";
+static const char CFG_SETTING_GFX_CHUNK_CACHE[] = "gfx_chunk_cache";
+static const char CFG_SETTING_GFX_FRAME_MODE[] = "gfx_frame_mode";
+static const char CFG_SETTING_GFX_FRAME_CAP[] = "gfx_frame_cap";
+static const char CFG_SETTING_GFX_TILE_BATCH[] = "gfx_tile_batch";
+static const char CFG_SETTING_WORLD_COMPRESSION[] = "world_compression";
+static const char CFG_SETTING_WORLD_STREAM_RADIUS[] = "world_stream_radius";
+static const char CFG_SETTING_WORLD_STREAM_CAP[] = "world_stream_cap";
+static const char CFG_SETTING_WORLD_PACKED[] = "world_packed";
+static const char CFG_SETTING_SIM_RATE[] = "sim_rate";
+static const char CFG_SETTING_SIM_MAX_STEPS[] = "sim_max_steps";
+static const char CFG_SETTING_SIM_THREADS[] = "sim_threads";
+static const char CFG_SETTING_SIM_FIXED[] = "sim_fixed";
+static const char CFG_SETTING_SIM_LOD_DISTANCE[] = "sim_lod_distance";
+static const char CFG_SETTING_SIM_LOD_INTERVAL[] = "sim_lod_interval";
 
 static const uint32_t CFG_STD_GFX_WINDOW_X = SDL_WINDOWPOS_CENTERED;
 static const uint32_t CFG_STD_GFX_WINDOW_Y = SDL_WINDOWPOS_CENTERED;
 static const float CFG_STD_GFX_WINDOW_W = 640.0f;
 static const float CFG_STD_GFX_WINDOW_H = 480.0f;
 static const bool CFG_STD_GFX_WINDOW_FULLSCREEN = false;
+static const int32_t CFG_STD_GFX_CHUNK_CACHE = 0;	/* MiB, 0 = off */
+static const int32_t CFG_STD_GFX_FRAME_MODE = 0;	/* see PacerMode */
+static const int32_t CFG_STD_GFX_FRAME_CAP = 60;	/* frames per second */
+static const bool CFG_STD_GFX_TILE_BATCH = true;	/* 0 = tile by tile */
+static const bool CFG_STD_WORLD_COMPRESSION = false;
+static const int32_t CFG_STD_WORLD_STREAM_RADIUS = 2;	/* chunks, 0 = off */
+static const int32_t CFG_STD_WORLD_STREAM_CAP = 64;	/* MiB */
+static const bool CFG_STD_WORLD_PACKED = false;
+static const int32_t CFG_STD_SIM_RATE = 120;	/* steps per second */
+static const int32_t CFG_STD_SIM_MAX_STEPS = 8;	/* catch-up cap per frame */
+static const int32_t CFG_STD_SIM_THREADS = 1;	/* 1 = off, 0 = one per CPU */
+static const bool CFG_STD_SIM_FIXED = false;	/* deterministic physics */
+static const int32_t CFG_STD_SIM_LOD_DISTANCE = 32;	/* blocks past view */
+static const int32_t CFG_STD_SIM_LOD_INTERVAL = 4;	/* steps, 1 = off */
 
 typedef struct Config {
 	bool invalid;
@@ -43,6 +71,20 @@ typedef struct Config {
 	int32_t gfx_window_w;
 	int32_t gfx_window_h;
 	bool gfx_window_fullscreen;
+	int32_t gfx_chunk_cache;
+	int32_t gfx_frame_mode;
+	int32_t gfx_frame_cap;
+	bool gfx_tile_batch;
+	bool world_compression;
+	int32_t world_stream_radius;
+	int32_t world_stream_cap;
+	bool world_packed;
+	int32_t sim_rate;
+	int32_t sim_max_steps;
+	int32_t sim_threads;
+	bool sim_fixed;
+	int32_t sim_lod_distance;
+	int32_t sim_lod_interval;
 } Config;
 
 Config Config_new(void);
@@ -17,93 +17,331 @@
  * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
  */
 
-#include <SG_world.h>
-#include <SG_physics.h>
+#include <math.h>
+#include <stdint.h>
+#include "world.h"
 #include "entity.h"
 
+/* tiles covered by [a, b), clipped to the world, false if none */
+static bool tile_span(float a, float b, size_t len, size_t *first,
+		      size_t *last)
+{
+	float f = floorf(a / BLOCK_SIZE);
+	float l = ceilf(b / BLOCK_SIZE) - 1.0f;
+
+	if (f < 0.0f)
+		f = 0.0f;
+
+	if (l > (float)len - 1.0f)
+		l = (float)len - 1.0f;
+
+	if (f > l)
+		return false;
+
+	*first = (size_t) f;
+	*last = (size_t) l;
+
+	return true;
+}
+
+/* lowest solid column of row y within x1 to x2, or SIZE_MAX */
+static size_t solid_first(const World * world, size_t y, size_t x1, size_t x2)
+{
+	uint64_t bits;
+
+	for (size_t w = x1 >> WORLD_SOLID_SHIFT;
+	     w <= x2 >> WORLD_SOLID_SHIFT; w++) {
+		bits = World_solid_word(world, w, y, x1, x2);
+
+		if (bits != 0)
+			return (w << WORLD_SOLID_SHIFT) +
+			    World_solid_first(bits);
+	}
+
+	return SIZE_MAX;
+}
+
+/* highest solid column of row y within x1 to x2, or SIZE_MAX */
+static size_t solid_last(const World * world, size_t y, size_t x1, size_t x2)
+{
+	uint64_t bits;
+
+	for (size_t w = (x2 >> WORLD_SOLID_SHIFT) + 1;
+	     w-- > x1 >> WORLD_SOLID_SHIFT;) {
+		bits = World_solid_word(world, w, y, x1, x2);
+
+		if (bits != 0)
+			return (w << WORLD_SOLID_SHIFT) +
+			    World_solid_last(bits);
+	}
+
+	return SIZE_MAX;
+}
+
 /*
-	player_pos: 		player.rect.x or y
-	player_velocity:	player.velocity_x or y
+	Contact with the solid tile line "tile", for a rect of "size" at
+	"start" moving "distance". An entity already overlapping that line
+	stays where it is, so it can still move out the other way.
 */
-bool_t Entity_move(SG_Entity * ent, float *pos, float *velocity, float distance,
-		   SG_World * world)
+static EntityHit sweep_hit(float start, float size, float distance,
+			   size_t tile)
 {
-	bool_t collision = FALSE;
-	int_fast32_t x1, y1, x2, y2;
-	SG_FRect block_hitbox;
+	EntityHit hit = {.hit = TRUE };
 
-	// set position
-	*pos += distance;
+	if (distance > 0.0f) {
+		hit.pos = tile * BLOCK_SIZE - size;
+		hit.normal = -1.0f;
 
-	// calculate which blocks to check
-	x1 = ent->rect.x / BLOCK_SIZE;
-	y1 = ent->rect.y / BLOCK_SIZE;
-	x2 = (ent->rect.x + ent->rect.w) / BLOCK_SIZE + 1;
-	y2 = (ent->rect.y + ent->rect.h) / BLOCK_SIZE + 1;
+		if (hit.pos < start)
+			hit.pos = start;
+	} else {
+		hit.pos = (tile + 1) * BLOCK_SIZE;
+		hit.normal = 1.0f;
 
-	// check if within bounds
-	if (x1 < 0)
-		x1 = 0;
+		if (hit.pos > start)
+			hit.pos = start;
+	}
+
+	hit.time = (hit.pos - start) / distance;
+
+	return hit;
+}
+
+/* tiles covered by [a, b) in fixed point, see tile_span */
+static bool tile_span_fixed(int64_t a, int64_t b, size_t len, size_t *first,
+			    size_t *last)
+{
+	const int64_t tile = (int64_t) BLOCK_SIZE * FIXED_ONE;
+	// floor division, b is exclusive
+	int64_t f = a >= 0 ? a / tile : -((tile - 1 - a) / tile);
+	int64_t l = b - 1 >= 0 ? (b - 1) / tile : -((tile - b) / tile);
 
-	if (x1 > (int_fast32_t) world->width - 1)
-		x1 = (int_fast32_t) world->width - 1;
+	if (f < 0)
+		f = 0;
 
-	if (y1 < 0)
-		y1 = 0;
+	if (l > (int64_t) len - 1)
+		l = (int64_t) len - 1;
 
-	if (y1 > (int_fast32_t) world->height - 1)
-		y1 = (int_fast32_t) world->height - 1;
+	if (f > l)
+		return false;
 
-	if (x2 < 0)
-		x2 = 0;
+	*first = (size_t) f;
+	*last = (size_t) l;
+
+	return true;
+}
+
+/*
+	Nearest solid column of x1 to x2 in rows y1 to y2, seen from x1 if
+	forward, else from x2. SIZE_MAX if there is none.
+*/
+static size_t sweep_columns(const World * world, size_t x1, size_t x2,
+			    size_t y1, size_t y2, bool forward)
+{
+	size_t x, best = SIZE_MAX;
 
-	if (x2 > (int_fast32_t) world->width - 1)
-		x2 = (int_fast32_t) world->width - 1;
+	// nearest solid column over all rows, each row narrows the search
+	for (size_t y = y1; y <= y2; y++) {
+		if (forward) {
+			x = solid_first(world, y, x1, x2);
 
-	if (y2 < 0)
-		y2 = 0;
+			if (x != SIZE_MAX) {
+				best = x;
 
-	if (y2 > (int_fast32_t) world->height - 1)
-		y2 = (int_fast32_t) world->height - 1;
+				if (x == x1)
+					break;
 
-	// collision check for nearby blocks
-	block_hitbox.w = BLOCK_SIZE;
-	block_hitbox.h = BLOCK_SIZE;
+				x2 = x - 1;
+			}
+		} else {
+			x = solid_last(world, y, x1, x2);
 
-	for (int_fast32_t x = x1; x <= x2; x++) {
-		for (int_fast32_t y = y1; y <= y2; y++) {
-			// if non-solid block here, skip
-			if (world->blocks[x][y][0] == B_NONE)
-				continue;
+			if (x != SIZE_MAX) {
+				best = x;
 
-			block_hitbox.x = x * BLOCK_SIZE;
-			block_hitbox.y = y * BLOCK_SIZE;
+				if (x == x2)
+					break;
 
-			// if collision
-			if (SG_box_within_box(&ent->rect, &block_hitbox)) {
-				// flag, reset pos, kill velocity
-				collision = TRUE;
-				*pos -= distance;
-				*velocity = 0.0f;
+				x1 = x + 1;
 			}
 		}
 	}
 
-	return collision;
+	return best;
+}
+
+/* nearest row of y1 to y2 with a solid tile in x1 to x2, see sweep_columns */
+static size_t sweep_rows(const World * world, size_t x1, size_t x2,
+			 size_t y1, size_t y2, bool forward)
+{
+	size_t y;
+
+	// rows from the leading edge on, first one with a solid tile stops
+	for (size_t i = 0; i <= y2 - y1; i++) {
+		y = forward ? y1 + i : y2 - i;
+
+		if (solid_first(world, y, x1, x2) != SIZE_MAX)
+			return y;
+	}
+
+	return SIZE_MAX;
+}
+
+/* sweep_hit in fixed point */
+static EntityFixedHit sweep_hit_fixed(Fixed start, Fixed size,
+				      Fixed distance, size_t tile)
+{
+	const int64_t edge = (int64_t) tile * BLOCK_SIZE * FIXED_ONE;
+	EntityFixedHit hit = {.hit = TRUE };
+	int64_t pos;
+
+	if (distance > 0) {
+		pos = edge - size;
+
+		if (pos < start)
+			pos = start;
+	} else {
+		pos = edge + (int64_t) BLOCK_SIZE * FIXED_ONE;
+
+		if (pos > start)
+			pos = start;
+	}
+
+	// between start and start + distance, so within range
+	hit.pos = (Fixed) pos;
+
+	return hit;
+}
+
+EntityHit Entity_sweep_x(const SG_FRect * rect, float x_distance,
+			 const World * world)
+{
+	EntityHit hit = {.hit = FALSE,.time = 1.0f };
+	const float lead = x_distance > 0.0f ? rect->x + rect->w : rect->x;
+	size_t x1, x2, y1, y2;
+	size_t best;
+
+	if (x_distance == 0.0f ||
+	    !tile_span(rect->y, rect->y + rect->h, world->height, &y1, &y2) ||
+	    !tile_span(x_distance > 0.0f ? lead : lead + x_distance,
+		       x_distance > 0.0f ? lead + x_distance : lead,
+		       world->width, &x1, &x2))
+		return hit;
+
+	best = sweep_columns(world, x1, x2, y1, y2, x_distance > 0.0f);
+
+	if (best == SIZE_MAX)
+		return hit;
+
+	return sweep_hit(rect->x, rect->w, x_distance, best);
+}
+
+EntityHit Entity_sweep_y(const SG_FRect * rect, float y_distance,
+			 const World * world)
+{
+	EntityHit hit = {.hit = FALSE,.time = 1.0f };
+	const float lead = y_distance > 0.0f ? rect->y + rect->h : rect->y;
+	size_t x1, x2, y1, y2;
+	size_t best;
+
+	if (y_distance == 0.0f ||
+	    !tile_span(rect->x, rect->x + rect->w, world->width, &x1, &x2) ||
+	    !tile_span(y_distance > 0.0f ? lead : lead + y_distance,
+		       y_distance > 0.0f ? lead + y_distance : lead,
+		       world->height, &y1, &y2))
+		return hit;
+
+	best = sweep_rows(world, x1, x2, y1, y2, y_distance > 0.0f);
+
+	if (best == SIZE_MAX)
+		return hit;
+
+	return sweep_hit(rect->y, rect->h, y_distance, best);
+}
+
+EntityFixedHit Entity_sweep_fixed_x(const FixedRect * rect, Fixed x_distance,
+				    const World * world)
+{
+	EntityFixedHit hit = {.hit = FALSE };
+	const int64_t lead =
+	    x_distance > 0 ? (int64_t) rect->x + rect->w : rect->x;
+	size_t x1, x2, y1, y2;
+	size_t best;
+
+	if (x_distance == 0 ||
+	    !tile_span_fixed(rect->y, (int64_t) rect->y + rect->h,
+			     world->height, &y1, &y2) ||
+	    !tile_span_fixed(x_distance > 0 ? lead : lead + x_distance,
+			     x_distance > 0 ? lead + x_distance : lead,
+			     world->width, &x1, &x2))
+		return hit;
+
+	best = sweep_columns(world, x1, x2, y1, y2, x_distance > 0);
+
+	if (best == SIZE_MAX)
+		return hit;
+
+	return sweep_hit_fixed(rect->x, rect->w, x_distance, best);
+}
+
+EntityFixedHit Entity_sweep_fixed_y(const FixedRect * rect, Fixed y_distance,
+				    const World * world)
+{
+	EntityFixedHit hit = {.hit = FALSE };
+	const int64_t lead =
+	    y_distance > 0 ? (int64_t) rect->y + rect->h : rect->y;
+	size_t x1, x2, y1, y2;
+	size_t best;
+
+	if (y_distance == 0 ||
+	    !tile_span_fixed(rect->x, (int64_t) rect->x + rect->w,
+			     world->width, &x1, &x2) ||
+	    !tile_span_fixed(y_distance > 0 ? lead : lead + y_distance,
+			     y_distance > 0 ? lead + y_distance : lead,
+			     world->height, &y1, &y2))
+		return hit;
+
+	best = sweep_rows(world, x1, x2, y1, y2, y_distance > 0);
+
+	if (best == SIZE_MAX)
+		return hit;
+
+	return sweep_hit_fixed(rect->y, rect->h, y_distance, best);
+}
+
+/*
+	pos: 		ent.rect.x or y
+	velocity:	ent.velocity_x or y
+*/
+static bool_t Entity_move(float *pos, float *velocity, float distance,
+			  EntityHit hit)
+{
+	if (!hit.hit) {
+		*pos += distance;
+		return FALSE;
+	}
+
+	// stop at the surface, kill velocity
+	*pos = hit.pos;
+	*velocity = 0.0f;
+
+	return TRUE;
 }
 
-void Entity_move_x(SG_Entity * ent, float x_distance, SG_World * world)
+void Entity_move_x(SG_Entity * ent, float x_distance, World * world)
 {
-	Entity_move(ent, &ent->rect.x, &ent->velocity_x, x_distance, world);
+	Entity_move(&ent->rect.x, &ent->velocity_x, x_distance,
+		    Entity_sweep_x(&ent->rect, x_distance, world));
 }
 
-void Entity_move_y(SG_Entity * ent, float y_distance, SG_World * world)
+void Entity_move_y(SG_Entity * ent, float y_distance, World * world)
 {
 	bool_t collision;
 
 	// move
 	collision =
-	    Entity_move(ent, &ent->rect.y, &ent->velocity_y, y_distance, world);
+	    Entity_move(&ent->rect.y, &ent->velocity_y, y_distance,
+			Entity_sweep_y(&ent->rect, y_distance, world));
 
 	// if falling and collision happened, set grounded, else set non-grounded
 	if (y_distance > 0.0f && collision)
@@ -22,6 +22,8 @@
 
 #include <SG_entity.h>
 #include "block.h"
+#include "fixed.h"
+#include "world.h"
 
 static const float ENTITY_VELOCITY_THRESHOLD = 0.01f;
 static const float ENTITY_GRAVITY = BLOCK_SIZE * 18;
@@ -55,8 +57,39 @@ static const SG_EntityData DATA_ENTITIES[] = {
 	 },
 };
 
-void Entity_move_x(SG_Entity * ent, float x_distance, SG_World * world);
+/*
+	Result of sweeping an entity rect along one axis.
+	time:	share of the distance travelled before contact, 0 to 1
+	normal:	contact normal on the axis, -1 or 1, 0 without hit
+	pos:	rect.x or y at contact, exact tile surface
+*/
+typedef struct EntityHit {
+	bool_t hit;
+	float time;
+	float normal;
+	float pos;
+} EntityHit;
+
+/* EntityHit of a fixed point rect, see Physics */
+typedef struct EntityFixedHit {
+	bool_t hit;
+	Fixed pos;
+} EntityFixedHit;
+
+EntityHit Entity_sweep_x(const SG_FRect * rect, float x_distance,
+			 const World * world);
+
+EntityHit Entity_sweep_y(const SG_FRect * rect, float y_distance,
+			 const World * world);
+
+EntityFixedHit Entity_sweep_fixed_x(const FixedRect * rect, Fixed x_distance,
+				    const World * world);
+
+EntityFixedHit Entity_sweep_fixed_y(const FixedRect * rect, Fixed y_distance,
+				    const World * world);
+
+void Entity_move_x(SG_Entity * ent, float x_distance, World * world);
 
-void Entity_move_y(SG_Entity * ent, float y_distance, SG_World * world);
+void Entity_move_y(SG_Entity * ent, float y_distance, World * world);
 
 #endif				// ENTITY_H
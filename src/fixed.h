@@ -0,0 +1,74 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+
+/*
+	Signed 20.12 fixed point numbers for the deterministic physics mode.
+	Integer math gives the same bits with every compiler, optimization
+	level and FPU, float does not (x87 excess precision, FMA
+	contraction). 16.16 would run out at 32768 px, 12 fraction bits
+	leave room for 8192 tiles per axis and still keep a step of gravity
+	within 0.01 % of the float value.
+*/
+typedef int32_t Fixed;
+
+#define FIXED_SHIFT 12
+#define FIXED_ONE ((Fixed) 1 << FIXED_SHIFT)
+
+// positions stay within this, so x + w or x + distance never overflow
+#define FIXED_LIMIT ((Fixed) 1 << 30)
+
+typedef struct FixedRect {
+	Fixed x;
+	Fixed y;
+	Fixed w;
+	Fixed h;
+} FixedRect;
+
+/* nearest fixed value, only for constants and loaded state */
+static inline Fixed Fixed_from_float(const float f)
+{
+	return (Fixed) (f * FIXED_ONE + (f < 0.0f ? -0.5f : 0.5f));
+}
+
+/* for drawing and other consumers of the float state */
+static inline float Fixed_to_float(const Fixed f)
+{
+	return (float)f / FIXED_ONE;
+}
+
+/* a + b, held within +-FIXED_LIMIT */
+static inline Fixed Fixed_add_limit(const Fixed a, const Fixed b)
+{
+	const int64_t sum = (int64_t) a + b;
+
+	if (sum > FIXED_LIMIT)
+		return FIXED_LIMIT;
+
+	if (sum < -FIXED_LIMIT)
+		return -FIXED_LIMIT;
+
+	return (Fixed) sum;
+}
+
+#endif				// FIXED_H
@@ -21,10 +21,16 @@
 #include <SM_string.h>
 #include <SGUI_sprite.h>
 #include <SGUI_theme.h>
-#include <time.h>
 #include "path.h"
 #include "config.h"
 #include "world.h"
+#include "stream.h"
+#include "save.h"
+#include "physics.h"
+#include "spatial.h"
+#include "cache.h"
+#include "pacer.h"
+#include "canvas.h"
 #include "game.h"
 
 #ifdef _WIN32
@@ -79,16 +85,92 @@ static const float EDIT_MOVE_SPEED = BLOCK_SIZE * 12;
 static const size_t EDIT_CROSSHAIR_SIZE = 10;
 static const float EDIT_SELECT_DELAY = 0.25f;
 static const float EDIT_SAVE_DELAY = 1.0f;
+static const float EDIT_SAVE_NOTICE = 1.5f;
+static const int EDIT_SAVE_BAR_HEIGHT = 4;
 
+/* wall clock seconds since the first call */
 float now(void)
 {
-	return (float)clock() / (float)CLOCKS_PER_SEC;
+	static Uint64 start = 0;
+
+	if (start == 0)
+		start = SDL_GetPerformanceCounter();
+
+	return (float)((double)(SDL_GetPerformanceCounter() - start) /
+		       (double)SDL_GetPerformanceFrequency());
+}
+
+static void Game_center_camera(Game * game, const float x, const float y)
+{
+	game->camera.x = x - (game->camera.w / 2);
+	game->camera.y = y - (game->camera.h / 2);
+
+	if (game->camera.x < 0)
+		game->camera.x = 0;
+
+	else if ((game->camera.x + game->camera.w) >=
+		 (int)(game->world.width * BLOCK_SIZE))
+		game->camera.x = (game->world.width * BLOCK_SIZE) - game->camera.w;
+
+	if (game->camera.y < 0)
+		game->camera.y = 0;
+
+	else if ((game->camera.y + game->camera.h) >=
+		 (int)(game->world.height * BLOCK_SIZE))
+		game->camera.y =
+		    (game->world.height * BLOCK_SIZE) - game->camera.h;
+}
+
+#ifdef _DEBUG
+static void Game_log_memory(Game * game)
+{
+	const WorldMemory mem = World_memory(&game->world);
+
+	printf("world \"%s\": %zu KiB blocks, %zu KiB mapped, "
+	       "%zu KiB tables, %zu KiB entities\n",
+	       game->world_name, mem.blocks / 1024, mem.mapped / 1024,
+	       mem.tables / 1024, mem.entities / 1024);
+
+	if (game->world.packed != NULL)
+		printf("packed planes by width: 0 bit %zu, 1 bit %zu, "
+		       "2 bit %zu, 4 bit %zu, 8 bit %zu\n", mem.planes[0],
+		       mem.planes[1], mem.planes[2], mem.planes[3],
+		       mem.planes[4]);
+}
+#endif
+
+#ifdef _DEBUG
+static void Game_log_frames(const FramePacer * pacer)
+{
+	static const char *const modes[PM_LAST + 1] = {
+		"vsync", "capped", "uncapped"
+	};
+
+	printf("frames (%s): %.2f ms mean, %.2f ms jitter, %.2f ms worst\n",
+	       modes[pacer->mode], pacer->stats.mean, pacer->stats.jitter,
+	       pacer->stats.worst);
 }
+#endif
 
-void Game_setup(Game * game)
+static void Game_stream(Game * game, const float velocity_x,
+			const float velocity_y, bool wait)
 {
+	// sprites are looked up by block id at draw time, so newly published
+	// chunks need no further setup
+	WorldStream_update(&game->world, &game->camera, velocity_x,
+			   velocity_y, wait);
+}
+
+void Game_setup(Game * game, const bool stream)
+{
+	SDL_Surface *surfaces[ATLAS_SPRITES];
+
 	game->active = true;
 	game->msg = SM_String_new(8);
+	game->atlas.texture = NULL;
+	game->atlas.rects = NULL;
+	game->batch.vertices = NULL;
+	game->batch.indices = NULL;
 
 	// set viewport
 	game->camera.x = 0;
@@ -106,12 +188,28 @@ void Game_setup(Game * game)
 		game->spr_ents[i] = SGUI_Sprite_new();
 
 	// open world and check
-	game->world = World_from_file(game->world_name);
+	if (stream && game->cfg->world_stream_radius > 0)
+		game->world =
+		    World_stream_from_file(game->world_name,
+					   game->cfg->world_stream_radius,
+					   (size_t)game->cfg->world_stream_cap *
+					   1024 * 1024);
+	else
+		game->world = World_from_file(game->world_name);
 
 	if (game->world.invalid) {
 		Game_clear(game);
 		return;
 	}
+	// palette planes instead of a byte per tile
+	if (game->cfg->world_packed && game->world.stream == NULL &&
+	    !World_pack(&game->world))
+		SM_log_warn("World could not be packed, keeping raw chunks.");
+
+#ifdef _DEBUG
+	Game_log_memory(game);
+#endif
+
 	// load block sprites
 	for (uint_fast32_t i = 1; i <= B_LAST; i++) {
 		game->spr_blocks[i] =
@@ -172,22 +270,132 @@ void Game_setup(Game * game)
 		}
 	}
 
-	// map textures
-	for (uint_fast32_t x = 0; x < game->world.width; x++) {
-		for (uint_fast32_t y = 0; y < game->world.height; y++) {
-			game->world.block_textures[x][y][0] =
-			    game->spr_blocks[game->world.blocks[x][y][0]].
-			    texture;
-			game->world.block_textures[x][y][1] =
-			    game->spr_walls[game->world.blocks[x][y][0]].
-			    texture;
-		}
+	// pack every sprite into one texture
+	for (uint_fast32_t i = 0; i <= B_LAST; i++) {
+		surfaces[i] = game->spr_blocks[i].surface;
+		surfaces[B_LAST + 1 + i] = game->spr_walls[i].surface;
 	}
 
+	for (uint_fast32_t i = 0; i <= E_LAST; i++)
+		surfaces[2 * (B_LAST + 1) + i] = game->spr_ents[i].surface;
+
+	game->atlas = Atlas_new(game->renderer, surfaces, ATLAS_SPRITES);
+
+	if (game->atlas.invalid) {
+		SM_log_err("Sprite atlas could not be created.");
+		Game_clear(game);
+		return;
+	}
+	// room for both layers of a screen or a chunk, whichever is more
+	game->batch = TileBatch_new(&game->atlas,
+				    (game->camera.w / BLOCK_SIZE + 2) *
+				    (game->camera.h / BLOCK_SIZE + 2) * 2 +
+				    WORLD_CHUNK_AREA * 2);
+
+	if (game->batch.invalid) {
+		SM_log_err("Tile batch could not be allocated.");
+		Game_clear(game);
+		return;
+	}
+
+	game->batch.copies = !game->cfg->gfx_tile_batch;
+
 	// set keyboard state pointer
 	game->kbd = SDL_GetKeyboardState(NULL);
 }
 
+/* wakes the entities around chunks with edited blocks */
+static void Game_wake_edits(Game * game, Physics * phys, SpatialHash * hash)
+{
+	const size_t chunks = game->world.chunks_w * game->world.chunks_h;
+	const float size = BLOCK_SIZE * WORLD_CHUNK_SIZE;
+	SG_FRect area;
+	size_t count;
+
+	if (game->world.edited_count == 0)
+		return;
+
+	for (size_t i = 0; i < chunks; i++) {
+		if (!(game->world.flags[i] & CF_EDITED))
+			continue;
+
+		game->world.flags[i] &= ~CF_EDITED;
+
+		// a tile beyond the chunk, for entities resting on its border
+		area.x = (i % game->world.chunks_w) * size - BLOCK_SIZE;
+		area.y = (i / game->world.chunks_w) * size - BLOCK_SIZE;
+		area.w = size + BLOCK_SIZE * 2;
+		area.h = size + BLOCK_SIZE * 2;
+		count = SpatialHash_query(hash, phys, &area);
+
+		for (size_t j = 0; j < count; j++)
+			Physics_wake(phys, hash->found[j]);
+	}
+
+	game->world.edited_count = 0;
+}
+
+/* advances the simulation by one fixed step */
+static void Game_step(Game * game, Physics * phys, PhysicsPool * pool,
+		      SpatialHash * hash, const size_t player, const float dt)
+{
+	SG_FRect view;
+
+	// handle keyboard, Physics_step clamps to max velocity
+	if (game->kbd[SDL_SCANCODE_A])
+		Physics_accelerate(phys, player,
+				   -DATA_ENTITIES[E_PLAYER].acceleration, 0.0f,
+				   dt);
+
+	if (game->kbd[SDL_SCANCODE_D])
+		Physics_accelerate(phys, player,
+				   DATA_ENTITIES[E_PLAYER].acceleration, 0.0f,
+				   dt);
+
+	if (game->kbd[SDL_SCANCODE_SPACE]) {
+		if (phys->grounded[player])
+			Physics_impulse(phys, player, 0.0f,
+					-DATA_ENTITIES[E_PLAYER].jump_velocity);
+	}
+
+	Game_wake_edits(game, phys, hash);
+
+	/*
+	   the camera around the stepped player, not the drawn one, so the
+	   level of detail does not depend on the frame rate
+	 */
+	view.w = game->camera.w;
+	view.h = game->camera.h;
+	view.x = phys->x[player] + phys->w[player] - view.w / 2.0f;
+	view.y = phys->y[player] + phys->h[player] - view.h / 2.0f;
+
+	// gravity, friction, movement of every entity
+	Physics_step(phys, &game->world, dt, &view, hash->order, pool);
+
+	if (!SpatialHash_build(hash, phys)) {
+		SM_log_err("Entity grid could not be allocated.");
+		game->active = false;
+		return;
+	}
+
+	SpatialHash_wake(hash, phys);
+}
+
+/* walls and, or blocks in the draw range, in one call */
+static void Game_draw_tiles(Game * game, const bool walls, const bool blocks)
+{
+	const SG_IPoint *pts = game->wld_draw_pts;
+	// a world smaller than the window has the camera before it
+	const int x1 = pts[0].x > 0 ? pts[0].x : 0;
+	const int y1 = pts[0].y > 0 ? pts[0].y : 0;
+
+	TileBatch_add_tiles(&game->batch, &game->world, x1, y1,
+			    pts[1].x, pts[1].y,
+			    x1 * BLOCK_SIZE - game->camera.x,
+			    y1 * BLOCK_SIZE - game->camera.y, walls, blocks);
+	TileBatch_draw(&game->batch, game->renderer, &game->stats);
+}
+
 void Game_run(Game * game)
 {
 #ifdef _DEBUG
@@ -203,32 +411,103 @@ void Game_run(Game * game)
 	SGUI_Label lbl_pos_y_val;
 	SGUI_Label lbl_grounded;
 	SGUI_Label lbl_grounded_val;
+	SGUI_Label lbl_switches;
+	SGUI_Label lbl_switches_val;
+	SGUI_Label lbl_overdraw;
+	SGUI_Label lbl_overdraw_val;
+	SGUI_Label lbl_frames;
+	SGUI_Label lbl_frames_val;
 #endif
 
-	SG_Entity *player = NULL;
+	Physics phys;
+	PhysicsPool pool;
+	SpatialHash hash;
+	ChunkCache cache;
+	FramePacer pacer;
+	const uint32_t *players;
+	size_t player;
+	size_t count;
+	SG_FRect view;
 	SDL_Rect temp;
 	float ts1, ts2, delta = 0.0f;
-	float x_step = 0.0f;
-	float y_step = 0.0f;
+	float sim_dt;
+	float sim_acc = 0.0f;
+	float alpha;
+	int32_t sim_rate;
+	int32_t sim_max_steps;
+	SG_FPoint player_draw;
 
 	// setup
-	Game_setup(game);
-
+	Game_setup(game, true);
+
+	sim_rate = game->cfg->sim_rate > 0 ?
+	    game->cfg->sim_rate : CFG_STD_SIM_RATE;
+	sim_dt = 1.0f / sim_rate;
+	sim_max_steps = game->cfg->sim_max_steps > 0 ?
+	    game->cfg->sim_max_steps : CFG_STD_SIM_MAX_STEPS;
+
+	// fixed point physics step at the sim rate, float ones take dt
+	if (game->cfg->sim_fixed && !Physics_fixed_fits(&game->world)) {
+		SM_log_warn("World too large for fixed point physics, "
+			    "using float.");
+		phys = Physics_new(&game->world, 0);
+	} else {
+		phys = Physics_new(&game->world,
+				   game->cfg->sim_fixed ? sim_rate : 0);
+	}
+	hash = SpatialHash_new(&game->world, phys.len);
+	pool = PhysicsPool_new(game->cfg->sim_threads > 0 ?
+			       game->cfg->sim_threads : SDL_GetCPUCount());
+
+	phys.lod_distance = (game->cfg->sim_lod_distance > 0 ?
+			     game->cfg->sim_lod_distance : 0) * BLOCK_SIZE;
+	phys.lod_interval = game->cfg->sim_lod_interval < 1 ? 1 :
+	    game->cfg->sim_lod_interval > UINT8_MAX ? UINT8_MAX :
+	    game->cfg->sim_lod_interval;
+
+	if (phys.invalid || hash.invalid || pool.invalid ||
+	    !SpatialHash_build(&hash, &phys)) {
+		SM_log_err("Entities could not be allocated.");
+		PhysicsPool_clear(&pool);
+		SpatialHash_clear(&hash);
+		Physics_clear(&phys);
+		Game_clear(game);
+		return;
+	}
 	// set 1st player of world as player
-	for (size_t i = 0; i < game->world.ent_count; i++)
-		if (game->world.entities[i].id == E_PLAYER)
-			player = &game->world.entities[i];
+	players = SpatialHash_type(&hash, E_PLAYER, &count);
 
-	if (player == NULL) {
+	if (count == 0) {
 		SM_String_copy_cstr(&game->msg, "World ");
 		SM_String_append_cstr(&game->msg, game->world_name);
 		SM_String_append_cstr(&game->msg,
 				      " does not contain a player entity.");
 		SM_log_err(game->msg.str);
 
+		PhysicsPool_clear(&pool);
+		SpatialHash_clear(&hash);
+		Physics_clear(&phys);
 		Game_clear(game);
 		return;
 	}
+
+	player = players[0];
+	// load the chunks around the player before the first frame
+	if (game->world.stream != NULL) {
+		Game_center_camera(game, phys.x[player] + phys.w[player],
+				   phys.y[player] + phys.h[player]);
+		Game_stream(game, 0.0f, 0.0f, true);
+	}
+	// chunks drawn once into textures, without them tile by tile
+	cache = ChunkCache_new(game->renderer, &game->world, &game->camera,
+			       (size_t)(game->cfg->gfx_chunk_cache > 0 ?
+					game->cfg->gfx_chunk_cache : 0) *
+			       1024 * 1024);
+
+	if (cache.invalid && game->cfg->gfx_chunk_cache > 0)
+		SM_log_warn("Chunk cache unavailable or below one screen, "
+			    "drawing tiles.");
+
 #ifdef _DEBUG
 	// load font
 	font =
@@ -252,6 +531,15 @@ void Game_run(Game * game)
 	SGUI_Label_new(&lbl_grounded, &mnu_debugvals, font, THEME_DEBUG.label);
 	SGUI_Label_new(&lbl_grounded_val, &mnu_debugvals, font,
 		       THEME_DEBUG.label);
+	SGUI_Label_new(&lbl_switches, &mnu_debugvals, font, THEME_DEBUG.label);
+	SGUI_Label_new(&lbl_switches_val, &mnu_debugvals, font,
+		       THEME_DEBUG.label);
+	SGUI_Label_new(&lbl_overdraw, &mnu_debugvals, font, THEME_DEBUG.label);
+	SGUI_Label_new(&lbl_overdraw_val, &mnu_debugvals, font,
+		       THEME_DEBUG.label);
+	SGUI_Label_new(&lbl_frames, &mnu_debugvals, font, THEME_DEBUG.label);
+	SGUI_Label_new(&lbl_frames_val, &mnu_debugvals, font,
+		       THEME_DEBUG.label);
 
 	// define menu
 	mnu_debugvals.rect.x = 0;
@@ -333,8 +621,58 @@ void Game_run(Game * game)
 	lbl_grounded_val.rect.x =
 	    lbl_grounded.rect.x + lbl_grounded.rect.w + 10;
 	lbl_grounded_val.rect.y = lbl_grounded.rect.y;
+
+	SM_String_copy_cstr(&lbl_switches.text, "tex_sw:");
+	SGUI_Label_update_sprite(&lbl_switches);
+	lbl_switches.rect.w = lbl_switches.sprite.surface->w;
+	lbl_switches.rect.h = lbl_switches.sprite.surface->h;
+	lbl_switches.rect.x = lbl_velocity_x.rect.x;
+	lbl_switches.rect.y =
+	    lbl_grounded_val.rect.y + lbl_grounded_val.rect.h + 10;
+
+	SM_String_copy_cstr(&lbl_switches_val.text, "0");
+	SGUI_Label_update_sprite(&lbl_switches_val);
+	lbl_switches_val.rect.w = lbl_switches_val.sprite.surface->w;
+	lbl_switches_val.rect.h = lbl_switches_val.sprite.surface->h;
+	lbl_switches_val.rect.x =
+	    lbl_switches.rect.x + lbl_switches.rect.w + 10;
+	lbl_switches_val.rect.y = lbl_switches.rect.y;
+
+	SM_String_copy_cstr(&lbl_overdraw.text, "overdraw:");
+	SGUI_Label_update_sprite(&lbl_overdraw);
+	lbl_overdraw.rect.w = lbl_overdraw.sprite.surface->w;
+	lbl_overdraw.rect.h = lbl_overdraw.sprite.surface->h;
+	lbl_overdraw.rect.x = lbl_velocity_x.rect.x;
+	lbl_overdraw.rect.y =
+	    lbl_switches_val.rect.y + lbl_switches_val.rect.h + 10;
+
+	SM_String_copy_cstr(&lbl_overdraw_val.text, "0");
+	SGUI_Label_update_sprite(&lbl_overdraw_val);
+	lbl_overdraw_val.rect.w = lbl_overdraw_val.sprite.surface->w;
+	lbl_overdraw_val.rect.h = lbl_overdraw_val.sprite.surface->h;
+	lbl_overdraw_val.rect.x =
+	    lbl_overdraw.rect.x + lbl_overdraw.rect.w + 10;
+	lbl_overdraw_val.rect.y = lbl_overdraw.rect.y;
+
+	SM_String_copy_cstr(&lbl_frames.text, "frame_ms:");
+	SGUI_Label_update_sprite(&lbl_frames);
+	lbl_frames.rect.w = lbl_frames.sprite.surface->w;
+	lbl_frames.rect.h = lbl_frames.sprite.surface->h;
+	lbl_frames.rect.x = lbl_velocity_x.rect.x;
+	lbl_frames.rect.y =
+	    lbl_overdraw_val.rect.y + lbl_overdraw_val.rect.h + 10;
+
+	SM_String_copy_cstr(&lbl_frames_val.text, "0");
+	SGUI_Label_update_sprite(&lbl_frames_val);
+	lbl_frames_val.rect.w = lbl_frames_val.sprite.surface->w;
+	lbl_frames_val.rect.h = lbl_frames_val.sprite.surface->h;
+	lbl_frames_val.rect.x = lbl_frames.rect.x + lbl_frames.rect.w + 10;
+	lbl_frames_val.rect.y = lbl_frames.rect.y;
 #endif
 
+	pacer = FramePacer_new(game->renderer, game->cfg->gfx_frame_mode,
+			       game->cfg->gfx_frame_cap);
+
 	// mainloop
 	while (game->active) {
 		ts1 = now();
@@ -346,66 +684,36 @@ void Game_run(Game * game)
 			case SDL_QUIT:
 				game->active = false;
 				break;
+
+			// the renderer dropped every target texture content
+			case SDL_RENDER_TARGETS_RESET:
+				if (!cache.invalid)
+					ChunkCache_reset(&cache);
+				break;
 			}
 		}
 
-		// handle keyboard
-		if (game->kbd[SDL_SCANCODE_A]) {
-			player->velocity_x -=
-			    DATA_ENTITIES[E_PLAYER].acceleration * delta;
-
-			if (player->velocity_x <
-			    DATA_ENTITIES[E_PLAYER].max_velocity * -1)
-				player->velocity_x =
-				    DATA_ENTITIES[E_PLAYER].max_velocity * -1;
-		}
+		// fixed steps, drop what is left after the catch-up cap
+		sim_acc += delta;
 
-		if (game->kbd[SDL_SCANCODE_D]) {
-			player->velocity_x +=
-			    DATA_ENTITIES[E_PLAYER].acceleration * delta;
+		if (sim_acc > sim_dt * sim_max_steps)
+			sim_acc = sim_dt * sim_max_steps;
 
-			if (player->velocity_x >
-			    DATA_ENTITIES[E_PLAYER].max_velocity)
-				player->velocity_x =
-				    DATA_ENTITIES[E_PLAYER].max_velocity;
+		while (sim_acc >= sim_dt) {
+			Game_step(game, &phys, &pool, &hash, player, sim_dt);
+			sim_acc -= sim_dt;
 		}
 
-		if (game->kbd[SDL_SCANCODE_SPACE]) {
-			if (player->grounded)
-				player->velocity_y -=
-				    DATA_ENTITIES[E_PLAYER].jump_velocity;
-		}
-		// gravity
-		player->velocity_y += ENTITY_GRAVITY * delta;
-
-		// apply walking friction or stop at velocity threshold
-		if (player->grounded) {
-			if (player->velocity_x > ENTITY_VELOCITY_THRESHOLD)
-				player->velocity_x -=
-				    DATA_ENTITIES[E_PLAYER].decceleration *
-				    delta;
-
-			else if (player->velocity_x <
-				 (ENTITY_VELOCITY_THRESHOLD * -1.0f))
-				player->velocity_x +=
-				    DATA_ENTITIES[E_PLAYER].decceleration *
-				    delta;
-
-			else
-				player->velocity_x = 0.0f;
-		}
-		// movement proccessing
-		if (player->velocity_x != 0.0f) {
-			x_step = player->velocity_x * delta;
-			Entity_move_x(player, x_step, &game->world);
-		}
+		// draw between the last two steps
+		alpha = sim_acc / sim_dt;
+		player_draw.x = phys.prev_x[player] +
+		    (phys.x[player] - phys.prev_x[player]) * alpha;
+		player_draw.y = phys.prev_y[player] +
+		    (phys.y[player] - phys.prev_y[player]) * alpha;
 
-		if (player->velocity_y != 0.0f) {
-			y_step = player->velocity_y * delta;
-			Entity_move_y(player, y_step, &game->world);
-		}
 #ifdef _DEBUG
-		sprintf(lbl_velocity_x_val.text.str, "%f", player->velocity_x);
+		sprintf(lbl_velocity_x_val.text.str, "%f",
+			phys.velocity_x[player]);
 		lbl_velocity_x_val.text.len =
 		    strlen(lbl_velocity_x_val.text.str);
 		SGUI_Label_update_sprite(&lbl_velocity_x_val);
@@ -414,7 +722,8 @@ void Game_run(Game * game)
 		lbl_velocity_x_val.rect.h =
 		    lbl_velocity_x_val.sprite.surface->h;
 
-		sprintf(lbl_velocity_y_val.text.str, "%f", player->velocity_y);
+		sprintf(lbl_velocity_y_val.text.str, "%f",
+			phys.velocity_y[player]);
 		lbl_velocity_y_val.text.len =
 		    strlen(lbl_velocity_y_val.text.str);
 		SGUI_Label_update_sprite(&lbl_velocity_y_val);
@@ -423,46 +732,61 @@ void Game_run(Game * game)
 		lbl_velocity_y_val.rect.h =
 		    lbl_velocity_y_val.sprite.surface->h;
 
-		sprintf(lbl_pos_x_val.text.str, "%f", player->rect.x);
+		sprintf(lbl_pos_x_val.text.str, "%f", phys.x[player]);
 		lbl_pos_x_val.text.len = strlen(lbl_pos_x_val.text.str);
 		SGUI_Label_update_sprite(&lbl_pos_x_val);
 		lbl_pos_x_val.rect.w = lbl_pos_x_val.sprite.surface->w;
 		lbl_pos_x_val.rect.h = lbl_pos_x_val.sprite.surface->h;
 
-		sprintf(lbl_pos_y_val.text.str, "%f", player->rect.y);
+		sprintf(lbl_pos_y_val.text.str, "%f", phys.y[player]);
 		lbl_pos_y_val.text.len = strlen(lbl_pos_y_val.text.str);
 		SGUI_Label_update_sprite(&lbl_pos_y_val);
 		lbl_pos_y_val.rect.w = lbl_pos_y_val.sprite.surface->w;
 		lbl_pos_y_val.rect.h = lbl_pos_y_val.sprite.surface->h;
 
-		sprintf(lbl_grounded_val.text.str, "%i", player->grounded);
+		sprintf(lbl_grounded_val.text.str, "%i", phys.grounded[player]);
 		lbl_grounded_val.text.len = strlen(lbl_grounded_val.text.str);
 		SGUI_Label_update_sprite(&lbl_grounded_val);
 		lbl_grounded_val.rect.w = lbl_grounded_val.sprite.surface->w;
 		lbl_grounded_val.rect.h = lbl_grounded_val.sprite.surface->h;
+
+		// texture switches of the last frame, out of its draw calls
+		sprintf(lbl_switches_val.text.str, "%u/%u",
+			(unsigned)game->stats.switches,
+			(unsigned)game->stats.calls);
+		lbl_switches_val.text.len = strlen(lbl_switches_val.text.str);
+		SGUI_Label_update_sprite(&lbl_switches_val);
+		lbl_switches_val.rect.w = lbl_switches_val.sprite.surface->w;
+		lbl_switches_val.rect.h = lbl_switches_val.sprite.surface->h;
+
+		// quads out of tiles batched last frame, walls culled
+		sprintf(lbl_overdraw_val.text.str, "%u/%u -%u",
+			(unsigned)game->stats.quads,
+			(unsigned)game->stats.tiles,
+			(unsigned)game->stats.culled);
+		lbl_overdraw_val.text.len = strlen(lbl_overdraw_val.text.str);
+		SGUI_Label_update_sprite(&lbl_overdraw_val);
+		lbl_overdraw_val.rect.w = lbl_overdraw_val.sprite.surface->w;
+		lbl_overdraw_val.rect.h = lbl_overdraw_val.sprite.surface->h;
+
+		// mean, jitter and worst frame time of the last pacer window
+		sprintf(lbl_frames_val.text.str, "%.2f %.2f %.2f",
+			pacer.stats.mean, pacer.stats.jitter,
+			pacer.stats.worst);
+		lbl_frames_val.text.len = strlen(lbl_frames_val.text.str);
+		SGUI_Label_update_sprite(&lbl_frames_val);
+		lbl_frames_val.rect.w = lbl_frames_val.sprite.surface->w;
+		lbl_frames_val.rect.h = lbl_frames_val.sprite.surface->h;
 #endif
 
 		// update camera
-		game->camera.x =
-		    (player->rect.x + player->rect.w) - (game->camera.w / 2);
-		game->camera.y =
-		    (player->rect.y + player->rect.h) - (game->camera.h / 2);
-
-		if (game->camera.x < 0)
-			game->camera.x = 0;
+		Game_center_camera(game, player_draw.x + phys.w[player],
+				   player_draw.y + phys.h[player]);
 
-		else if ((game->camera.x + game->camera.w) >=
-			 (int)(game->world.width * BLOCK_SIZE))
-			game->camera.x =
-			    (game->world.width * BLOCK_SIZE) - game->camera.w;
-
-		if (game->camera.y < 0)
-			game->camera.y = 0;
-
-		else if ((game->camera.y + game->camera.h) >=
-			 (int)(game->world.height * BLOCK_SIZE))
-			game->camera.y =
-			    (game->world.height * BLOCK_SIZE) - game->camera.h;
+		// page in chunks around the camera
+		if (game->world.stream != NULL)
+			Game_stream(game, phys.velocity_x[player],
+				    phys.velocity_y[player], false);
 
 		// update block draw range
 		game->wld_draw_pts[0].x = (game->camera.x / BLOCK_SIZE);
@@ -480,49 +804,47 @@ void Game_run(Game * game)
 			game->wld_draw_pts[1].y = game->world.height;
 
 		// draw background
+		RenderStats_frame(&game->stats);
 		SDL_SetRenderDrawColor(game->renderer, 155, 219, 245, 255);
 		SDL_RenderClear(game->renderer);
 
 		// draw walls and blocks
-		for (int x = game->wld_draw_pts[0].x;
-		     x < game->wld_draw_pts[1].x; x++) {
-			for (int y = game->wld_draw_pts[0].y;
-			     y < game->wld_draw_pts[1].y; y++) {
-				temp.x = (x * BLOCK_SIZE) - game->camera.x;
-				temp.y = (y * BLOCK_SIZE) - game->camera.y;
-				temp.w = BLOCK_SIZE;
-				temp.h = BLOCK_SIZE;
-
-				SDL_RenderCopy(game->renderer,
-					       game->world.
-					       block_textures[x][y][1], NULL,
-					       &temp);
-
-				SDL_RenderCopy(game->renderer,
-					       game->world.
-					       block_textures[x][y][0], NULL,
-					       &temp);
-			}
-		}
-
-		// draw entities
-		for (size_t i = 0; i < game->world.ent_count; i++) {
-			switch (game->world.entities[i].id) {
-			case E_NONE:
-			case E_PLAYER:
-				break;
-			}
+		if (!cache.invalid)
+			ChunkCache_draw(&cache, &game->world, &game->camera,
+					&game->batch, &game->stats);
+		else
+			Game_draw_tiles(game, true, true);
+
+		// draw entities near the camera, between the last two steps
+		view.x = game->camera.x - BLOCK_SIZE;
+		view.y = game->camera.y - BLOCK_SIZE;
+		view.w = game->camera.w + BLOCK_SIZE * 2;
+		view.h = game->camera.h + BLOCK_SIZE * 2;
+		count = SpatialHash_query(&hash, &phys, &view);
+
+		for (size_t j = 0; j < count; j++) {
+			const size_t i = hash.found[j];
+
+			temp.x = phys.prev_x[i] +
+			    (phys.x[i] - phys.prev_x[i]) * alpha -
+			    game->camera.x;
+			temp.y = phys.prev_y[i] +
+			    (phys.y[i] - phys.prev_y[i]) * alpha -
+			    game->camera.y;
+			temp.w = phys.w[i];
+			temp.h = phys.h[i];
+
+			if (temp.x + temp.w < 0 || temp.y + temp.h < 0 ||
+			    temp.x >= game->camera.w ||
+			    temp.y >= game->camera.h)
+				continue;
+
+			Render_copy(game->renderer, &game->stats,
+				    game->atlas.texture,
+				    Atlas_entity(&game->atlas, phys.id[i]),
+				    &temp);
 		}
 
-		// draw player
-		temp.x = player->rect.x - game->camera.x;
-		temp.y = player->rect.y - game->camera.y;
-		temp.w = player->rect.w;
-		temp.h = player->rect.h;
-
-		SDL_RenderCopy(game->renderer,
-			       game->spr_ents[E_PLAYER].texture, NULL, &temp);
-
 #ifdef _DEBUG
 		// draw debug menu
 		SGUI_Menu_draw(&mnu_debugvals);
@@ -530,6 +852,7 @@ void Game_run(Game * game)
 
 		// show drawn image
 		SDL_RenderPresent(game->renderer);
+		FramePacer_wait(&pacer);
 
 		// timestamp and delta
 		ts2 = now();
@@ -537,10 +860,150 @@ void Game_run(Game * game)
 		delta *= TIMESCALE;
 	}
 
+#ifdef _DEBUG
+	Game_log_frames(&pacer);
+#endif
+
 	// clear
+	ChunkCache_clear(&cache);
+	PhysicsPool_clear(&pool);
+	SpatialHash_clear(&hash);
+	Physics_clear(&phys);
 	Game_clear(game);
 }
 
+/* edits a shown tile, only a change gets its area drawn again */
+static void Game_edit_tile(Game * game, Canvas * canvas, const size_t x,
+			   const size_t y, const Layer layer, const Block block)
+{
+	const SDL_Rect area = {
+		.x = (int)x * BLOCK_SIZE,
+		.y = (int)y * BLOCK_SIZE,
+		.w = BLOCK_SIZE,
+		.h = BLOCK_SIZE,
+	};
+
+	if (x >= game->world.width || y >= game->world.height ||
+	    World_get_block(&game->world, x, y, layer) == block)
+		return;
+
+	if (World_edit_block(&game->world, x, y, layer, block))
+		Canvas_dirty(canvas, &area);
+}
+
+/* editor view of a screen area: background, walls, blocks and grid */
+static void Game_draw_area(Game * game, const SDL_Rect * area,
+			   const bool grid, const bool walls, const bool blocks)
+{
+	const int px = game->camera.x + area->x;
+	const int py = game->camera.y + area->y;
+	int x1 = px / BLOCK_SIZE;
+	int y1 = py / BLOCK_SIZE;
+	int x2 = (px + area->w + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	int y2 = (py + area->h + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	SDL_Rect cell;
+
+	// a world smaller than the window has the camera before it
+	x1 = x1 > 0 ? x1 : 0;
+	y1 = y1 > 0 ? y1 : 0;
+	x2 = x2 < (int)game->world.width ? x2 : (int)game->world.width;
+	y2 = y2 < (int)game->world.height ? y2 : (int)game->world.height;
+
+	// tiles and grid cells reach out of the area, keep them in it
+	SDL_RenderSetClipRect(game->renderer, area);
+	SDL_SetRenderDrawColor(game->renderer, 50, 50, 50, 255);
+	SDL_RenderFillRect(game->renderer, area);
+
+	if (x1 >= x2 || y1 >= y2)
+		return;
+
+	TileBatch_add_tiles(&game->batch, &game->world, x1, y1, x2, y2,
+			    x1 * BLOCK_SIZE - game->camera.x,
+			    y1 * BLOCK_SIZE - game->camera.y, walls, blocks);
+	TileBatch_draw(&game->batch, game->renderer, &game->stats);
+
+	if (!grid)
+		return;
+
+	SDL_SetRenderDrawColor(game->renderer, 0, 0, 0, 50);
+	cell.w = BLOCK_SIZE;
+	cell.h = BLOCK_SIZE;
+
+	for (int x = x1; x < x2; x++) {
+		for (int y = y1; y < y2; y++) {
+			cell.x = (x * BLOCK_SIZE) - game->camera.x;
+			cell.y = (y * BLOCK_SIZE) - game->camera.y;
+
+			SDL_RenderDrawRect(game->renderer, &cell);
+		}
+	}
+}
+
+/* crosshair, selected block and save bar, on top of the canvas */
+static void Game_draw_edit_ui(Game * game, const SG_FPoint * edit_pos,
+			      const Block edit_block, const int save_bar,
+			      const SaveState save_state)
+{
+	SDL_Rect temp;
+
+	// draw edit pos as crosshair
+	SDL_SetRenderDrawColor(game->renderer, 255, 0, 0, 255);
+	SDL_RenderDrawLine(game->renderer,
+			   edit_pos->x - EDIT_CROSSHAIR_SIZE - game->camera.x,
+			   edit_pos->y - game->camera.y,
+			   edit_pos->x + EDIT_CROSSHAIR_SIZE - game->camera.x,
+			   edit_pos->y - game->camera.y);
+
+	SDL_RenderDrawLine(game->renderer,
+			   edit_pos->x - game->camera.x,
+			   edit_pos->y - EDIT_CROSSHAIR_SIZE - game->camera.y,
+			   edit_pos->x - game->camera.x,
+			   edit_pos->y + EDIT_CROSSHAIR_SIZE - game->camera.y);
+
+	// draw currently selected block (border)
+	temp.x = BLOCK_SIZE;
+	temp.y = 0;
+	temp.w = 2;
+	temp.h = BLOCK_SIZE + 2;
+
+	SDL_SetRenderDrawColor(game->renderer, 255, 255, 0, 255);
+	SDL_RenderFillRect(game->renderer, &temp);
+
+	temp.x = 0;
+	temp.y = BLOCK_SIZE;
+	temp.w = BLOCK_SIZE + 2;
+	temp.h = 2;
+
+	SDL_RenderFillRect(game->renderer, &temp);
+
+	// (block)
+	temp.x = 0;
+	temp.y = 0;
+	temp.w = BLOCK_SIZE;
+	temp.h = BLOCK_SIZE;
+
+	Render_copy(game->renderer, &game->stats, game->atlas.texture,
+		    Atlas_tile(&game->atlas, L_BLOCK, edit_block), &temp);
+
+	// draw save progress (below selected block)
+	if (save_bar <= 0)
+		return;
+
+	if (save_state == SS_RUNNING)
+		SDL_SetRenderDrawColor(game->renderer, 255, 255, 0, 255);
+	else if (save_state == SS_DONE)
+		SDL_SetRenderDrawColor(game->renderer, 0, 255, 0, 255);
+	else
+		SDL_SetRenderDrawColor(game->renderer, 255, 0, 0, 255);
+
+	temp.x = 0;
+	temp.y = BLOCK_SIZE + 4;
+	temp.w = save_bar;
+	temp.h = EDIT_SAVE_BAR_HEIGHT;
+
+	SDL_RenderFillRect(game->renderer, &temp);
+}
+
 void Game_edit(Game * game, const size_t width, const size_t height)
 {
 	SM_String filepath = SM_String_new(8);
@@ -557,11 +1020,20 @@ void Game_edit(Game * game, const size_t width, const size_t height)
 		.y = 0,
 	};
 	Block edit_block = B_FIRST;
+	Block shown_block = B_FIRST;
+	SG_FPoint shown_pos = edit_pos;
+	int save_bar = 0;
+	int shown_save_bar = 0;
+	SaveState shown_save_state = SS_IDLE;
+	Canvas canvas;
+	FramePacer pacer;
 	float ts1, ts2, delta = 0.0f;
 	float ts_ui_event = 0.0f;
 	bool edit_draw_grid = true;
 	bool edit_draw_blocks = true;
 	bool edit_draw_walls = true;
+	WorldSave save = WorldSave_new();
+	float ts_save_done = 0.0f;
 
 	// if world does not yet exist, create
 	if (get_world_path(&filepath) != 0)
@@ -574,19 +1046,25 @@ void Game_edit(Game * game, const size_t width, const size_t height)
 	if (file_check_existence(filepath.str) == false) {
 		game->world = World_new(width, height);
 
-		for (size_t x = 0; x < game->world.width; x++) {
-			for (size_t y = 0; y < game->world.height; y++) {
-				game->world.blocks[x][y][0] = B_NONE;
-				game->world.blocks[x][y][1] = B_NONE;
-			}
+		if (game->world.invalid) {
+			SM_String_clear(&filepath);
+			return;
 		}
 
-		World_write(&game->world, game->world_name);
+		World_fill(&game->world, L_BLOCK, B_NONE);
+		World_fill(&game->world, L_WALL, B_NONE);
 
-		SG_World_clear(&game->world);
+		World_write(&game->world, game->world_name,
+			    game->cfg->world_compression);
+
+		World_clear(&game->world);
 	}
 	// setup
-	Game_setup(game);
+	Game_setup(game, false);
+	canvas = Canvas_new(game->renderer, game->camera.x, game->camera.y,
+			    game->camera.w, game->camera.h);
+	pacer = FramePacer_new(game->renderer, game->cfg->gfx_frame_mode,
+			       game->cfg->gfx_frame_cap);
 
 	// mainloop
 	while (game->active) {
@@ -612,27 +1090,27 @@ void Game_edit(Game * game, const size_t width, const size_t height)
 
 				// if left click, edit block
 				if (mouse_state & SDL_BUTTON_LMASK) {
-					game->world.blocks[edit_pt.x][edit_pt.
-								      y][0] =
-					    edit_block;
-					game->world.block_textures[edit_pt.
-								   x][edit_pt.
-								      y][0] =
-					    game->spr_blocks[edit_block].
-					    texture;
+					Game_edit_tile(game, &canvas,
+						       edit_pt.x, edit_pt.y,
+						       L_BLOCK, edit_block);
 				}
 				// if right click, edit wall
 				else if (mouse_state & SDL_BUTTON_RMASK) {
-					game->world.blocks[edit_pt.x][edit_pt.
-								      y][1] =
-					    edit_block;
-					game->world.block_textures[edit_pt.
-								   x][edit_pt.
-								      y][1] =
-					    game->spr_walls[edit_block].texture;
+					Game_edit_tile(game, &canvas,
+						       edit_pt.x, edit_pt.y,
+						       L_WALL, edit_block);
 				}
 				break;
 
+			case SDL_WINDOWEVENT:
+				// exposed, the screen needs the canvas again
+				Canvas_touch(&canvas);
+				break;
+
+			case SDL_RENDER_TARGETS_RESET:
+				Canvas_reset(&canvas);
+				break;
+
 			case SDL_MOUSEWHEEL:
 				//select block
 				if (game->event.wheel.y > 0) {
@@ -698,16 +1176,19 @@ void Game_edit(Game * game, const size_t width, const size_t height)
 			// drawing control
 			if (game->kbd[SDL_SCANCODE_F1]) {
 				edit_draw_grid = !edit_draw_grid;
+				Canvas_dirty_all(&canvas);
 				ts_ui_event = now();
 			}
 
 			if (game->kbd[SDL_SCANCODE_F2]) {
 				edit_draw_blocks = !edit_draw_blocks;
+				Canvas_dirty_all(&canvas);
 				ts_ui_event = now();
 			}
 
 			if (game->kbd[SDL_SCANCODE_F3]) {
 				edit_draw_walls = !edit_draw_walls;
+				Canvas_dirty_all(&canvas);
 				ts_ui_event = now();
 			}
 		}
@@ -716,7 +1197,10 @@ void Game_edit(Game * game, const size_t width, const size_t height)
 			// ctrl + s, save
 			if (game->kbd[SDL_SCANCODE_LCTRL] &&
 			    game->kbd[SDL_SCANCODE_S]) {
-				World_write(&game->world, game->world_name);
+				WorldSave_start(&save, &game->world,
+						game->world_name,
+						game->cfg->world_compression);
+				ts_save_done = now();
 				ts_ui_event = now();
 			}
 			// ctrl + q, quit
@@ -728,166 +1212,78 @@ void Game_edit(Game * game, const size_t width, const size_t height)
 		}
 		// arrow up, set wall
 		if (game->kbd[SDL_SCANCODE_DOWN]) {
-			game->world.blocks[edit_pt.x][edit_pt.y][1] =
-			    edit_block;
-			game->world.block_textures[edit_pt.x][edit_pt.y][1] =
-			    game->spr_walls[edit_block].texture;
+			Game_edit_tile(game, &canvas, edit_pt.x, edit_pt.y,
+				       L_WALL, edit_block);
 		}
 		// arrow down, set block
 		if (game->kbd[SDL_SCANCODE_UP]) {
-			game->world.blocks[edit_pt.x][edit_pt.y][0] =
-			    edit_block;
-			game->world.block_textures[edit_pt.x][edit_pt.y][0] =
-			    game->spr_blocks[edit_block].texture;
-		}
-		// update viewport
-		game->camera.x = edit_pos.x - (game->camera.w / 2);
-		game->camera.y = edit_pos.y - (game->camera.h / 2);
-
-		if (game->camera.x < 0)
-			game->camera.x = 0;
-
-		else if ((game->camera.x + game->camera.w) >=
-			 (int)(game->world.width * BLOCK_SIZE))
-			game->camera.x =
-			    (game->world.width * BLOCK_SIZE) - game->camera.w;
-
-		if (game->camera.y < 0)
-			game->camera.y = 0;
-
-		else if ((game->camera.y + game->camera.h) >=
-			 (int)(game->world.height * BLOCK_SIZE))
-			game->camera.y =
-			    (game->world.height * BLOCK_SIZE) - game->camera.h;
-
-		// update block draw range
-		game->wld_draw_pts[0].x = (game->camera.x / BLOCK_SIZE);
-		game->wld_draw_pts[0].y = (game->camera.y / BLOCK_SIZE);
-
-		game->wld_draw_pts[1].x =
-		    ((game->camera.x + game->camera.w) / BLOCK_SIZE);
-		game->wld_draw_pts[1].y =
-		    ((game->camera.y + game->camera.h) / BLOCK_SIZE);
-
-		if (game->wld_draw_pts[1].x >= (s32_t) game->world.width)
-			game->wld_draw_pts[1].x = game->world.width;
-
-		if (game->wld_draw_pts[1].y >= (s32_t) game->world.height)
-			game->wld_draw_pts[1].y = game->world.height;
-
-		// draw background
-		SDL_SetRenderDrawColor(game->renderer, 50, 50, 50, 255);
-		SDL_RenderClear(game->renderer);
-
-		// if enabled, draw walls
-		if (edit_draw_walls) {
-			for (int x = game->wld_draw_pts[0].x;
-			     x < game->wld_draw_pts[1].x; x++) {
-				for (int y = game->wld_draw_pts[0].y;
-				     y < game->wld_draw_pts[1].y; y++) {
-					temp.x =
-					    (x * BLOCK_SIZE) - game->camera.x;
-					temp.y =
-					    (y * BLOCK_SIZE) - game->camera.y;
-					temp.w = BLOCK_SIZE;
-					temp.h = BLOCK_SIZE;
-
-					SDL_RenderCopy(game->renderer,
-						       game->world.
-						       block_textures[x][y][1],
-						       NULL, &temp);
-				}
-			}
+			Game_edit_tile(game, &canvas, edit_pt.x, edit_pt.y,
+				       L_BLOCK, edit_block);
 		}
-		// if enabled, draw blocks
-		if (edit_draw_blocks) {
-			for (int x = game->wld_draw_pts[0].x;
-			     x < game->wld_draw_pts[1].x; x++) {
-				for (int y = game->wld_draw_pts[0].y;
-				     y < game->wld_draw_pts[1].y; y++) {
-					temp.x =
-					    (x * BLOCK_SIZE) - game->camera.x;
-					temp.y =
-					    (y * BLOCK_SIZE) - game->camera.y;
-					temp.w = BLOCK_SIZE;
-					temp.h = BLOCK_SIZE;
-
-					SDL_RenderCopy(game->renderer,
-						       game->world.
-						       block_textures[x][y][0],
-						       NULL, &temp);
-				}
-			}
+		// collect finished background save
+		if (WorldSave_update(&save, &game->world))
+			ts_save_done = now();
+
+		// update viewport, what stays on screen is kept
+		Game_center_camera(game, edit_pos.x, edit_pos.y);
+		Canvas_scroll(&canvas, game->camera.x, game->camera.y);
+
+		// save progress, or result for a moment
+		if (save.state == SS_RUNNING)
+			save_bar = (BLOCK_SIZE + 2) * WorldSave_progress(&save);
+		else if (save.state != SS_IDLE &&
+			 now() < ts_save_done + EDIT_SAVE_NOTICE)
+			save_bar = BLOCK_SIZE + 2;
+		else
+			save_bar = 0;
+
+		// crosshair, selected block and save bar are drawn over it
+		if (edit_pos.x != shown_pos.x || edit_pos.y != shown_pos.y ||
+		    edit_block != shown_block || save_bar != shown_save_bar ||
+		    save.state != shown_save_state) {
+			shown_pos = edit_pos;
+			shown_block = edit_block;
+			shown_save_bar = save_bar;
+			shown_save_state = save.state;
+			Canvas_touch(&canvas);
 		}
-		// if enabled, draw grid
-		if (edit_draw_grid) {
-			SDL_SetRenderDrawColor(game->renderer, 0, 0, 0, 50);
-
-			for (int x = game->wld_draw_pts[0].x;
-			     x < game->wld_draw_pts[1].x; x++) {
-				for (int y = game->wld_draw_pts[0].y;
-				     y < game->wld_draw_pts[1].y; y++) {
-					temp.x =
-					    (x * BLOCK_SIZE) - game->camera.x;
-					temp.y =
-					    (y * BLOCK_SIZE) - game->camera.y;
-					temp.w = BLOCK_SIZE;
-					temp.h = BLOCK_SIZE;
-
-					SDL_RenderDrawRect(game->renderer,
-							   &temp);
-				}
+		// draw what changed, a frame without changes is not shown
+		if (Canvas_begin(&canvas)) {
+			RenderStats_frame(&game->stats);
+
+			for (size_t i = 0; i < canvas.len; i++) {
+				temp = Canvas_area(&canvas, i);
+				Game_draw_area(game, &temp, edit_draw_grid,
+					       edit_draw_walls,
+					       edit_draw_blocks);
 			}
-		}
-		// draw edit pos as crosshair
-		SDL_SetRenderDrawColor(game->renderer, 255, 0, 0, 255);
-		SDL_RenderDrawLine(game->renderer,
-				   edit_pos.x - EDIT_CROSSHAIR_SIZE -
-				   game->camera.x, edit_pos.y - game->camera.y,
-				   edit_pos.x + EDIT_CROSSHAIR_SIZE -
-				   game->camera.x, edit_pos.y - game->camera.y);
-
-		SDL_RenderDrawLine(game->renderer,
-				   edit_pos.x - game->camera.x,
-				   edit_pos.y - EDIT_CROSSHAIR_SIZE -
-				   game->camera.y, edit_pos.x - game->camera.x,
-				   edit_pos.y + EDIT_CROSSHAIR_SIZE -
-				   game->camera.y);
-
-		// draw currently selected block (border)
-		temp.x = BLOCK_SIZE;
-		temp.y = 0;
-		temp.w = 2;
-		temp.h = BLOCK_SIZE + 2;
-
-		SDL_SetRenderDrawColor(game->renderer, 255, 255, 0, 255);
-		SDL_RenderFillRect(game->renderer, &temp);
 
-		temp.x = 0;
-		temp.y = BLOCK_SIZE;
-		temp.w = BLOCK_SIZE + 2;
-		temp.h = 2;
+			Canvas_end(&canvas);
+			Game_draw_edit_ui(game, &edit_pos, edit_block,
+					  save_bar, save.state);
 
-		SDL_RenderFillRect(game->renderer, &temp);
-
-		// (block)
-		temp.x = 0;
-		temp.y = 0;
-		temp.w = BLOCK_SIZE;
-		temp.h = BLOCK_SIZE;
-
-		SDL_RenderCopy(game->renderer,
-			       game->spr_blocks[edit_block].texture,
-			       NULL, &temp);
-
-		// show drawn image
-		SDL_RenderPresent(game->renderer);
+			// show drawn image
+			SDL_RenderPresent(game->renderer);
+			FramePacer_wait(&pacer);
+		} else {
+			FramePacer_idle(&pacer);
+		}
 
 		// timestamp and delta
 		ts2 = now();
 		delta = ts2 - ts1;
 	}
 
+#ifdef _DEBUG
+	Game_log_frames(&pacer);
+#endif
+	Canvas_clear(&canvas);
+
+	// finish pending save before the world goes away
+	WorldSave_wait(&save, &game->world);
+	WorldSave_clear(&save);
+	SM_String_clear(&filepath);
+
 	// clear
 	Game_clear(game);
 }
@@ -907,8 +1303,12 @@ void Game_clear(Game * game)
 		SGUI_Sprite_clear(&game->spr_ents[i]);
 	}
 
+	// sprite atlas
+	TileBatch_clear(&game->batch);
+	Atlas_clear(&game->atlas);
+
 	// world
-	SG_World_clear(&game->world);
+	World_clear(&game->world);
 
 	// string
 	SM_String_clear(&game->msg);
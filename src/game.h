@@ -24,6 +24,9 @@
 #include <SDL_render.h>
 #include "entity.h"
 #include "block.h"
+#include "world.h"
+#include "atlas.h"
+#include "render.h"
 
 typedef struct Config Config;
 
@@ -39,14 +42,17 @@ typedef struct Game {
 	SGUI_Sprite spr_blocks[B_LAST + 1];
 	SGUI_Sprite spr_walls[B_LAST + 1];
 	SGUI_Sprite spr_ents[E_LAST + 1];
-	SG_World world;
+	Atlas atlas;
+	TileBatch batch;
+	RenderStats stats;
+	World world;
 	SDL_Event event;
 	const uint8_t *kbd;
 	SG_IPoint wld_draw_pts[2];
 	SDL_Rect camera;
 } Game;
 
-void Game_setup(Game * game);
+void Game_setup(Game * game, const bool stream);
 
 void Game_run(Game * game);
 
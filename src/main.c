@@ -33,6 +33,7 @@
 #include "app.h"
 #include "motd.h"
 #include "world.h"
+#include "catalog.h"
 #include "game.h"
 
 static const int FONT_SIZE = 16;
@@ -45,6 +46,18 @@ static const uint_fast32_t MNU_MAIN_Y = 200;
 static const uint_fast32_t MNU_SUB_X = MNU_MAIN_X + 25;
 static const uint_fast32_t MNU_SUB_Y = MNU_MAIN_Y + 0;
 
+#define WORLD_LIST_LEN 8
+
+static const int WORLD_THUMB_W = WORLDFILE_THUMB_W;
+static const int WORLD_THUMB_H = WORLDFILE_THUMB_H / 2;
+
+/* RGBA8888, walls use the wall sprite color mod */
+static const uint32_t WORLD_THUMB_COLORS[] = {
+	[B_NONE] = 0x9bdbf5ff,
+	[B_DIRT] = 0x866043ff,
+	[B_STONE] = 0x7d7d7dff,
+};
+
 static const SGUI_Theme THEME_MASTER = {
 	.menu = {
 		 .bg_color = {.r = 155,.g = 219,.b = 245,.a = 255},
@@ -140,6 +153,22 @@ typedef struct BtnSettingsData {
 	SGUI_Entry *txt_gfx_window_fullscreen;
 } BtnSettingsData;
 
+typedef struct WorldListData {
+	MenuData *menu_data;
+	Game *game;
+	Catalog catalog;
+	size_t page;
+	SGUI_Button *btn_worlds;
+	SGUI_Label *lbl_page;
+	SDL_Texture *thumbs[WORLD_LIST_LEN];
+	char text[CATALOG_NAME_MAX + 32];
+} WorldListData;
+
+typedef struct BtnWorldData {
+	WorldListData *list;
+	size_t slot;
+} BtnWorldData;
+
 typedef struct BtnStartEditData {
 	Game game;
 
@@ -148,14 +177,119 @@ typedef struct BtnStartEditData {
 	SGUI_Entry *txt_edit_height;
 } BtnStartEditData;
 
+static void world_thumb_update(SDL_Texture * texture,
+			       const CatalogEntry * entry)
+{
+	uint32_t pixels[WORLDFILE_THUMB_BYTES];
+	uint32_t color;
+	uint8_t cell;
+	uint8_t block;
+
+	for (size_t i = 0; i < WORLDFILE_THUMB_BYTES; i++) {
+		cell = entry == NULL ? B_NONE : entry->thumbnail[i];
+		block = cell & ~WORLDFILE_THUMB_WALL;
+
+		if (block > B_LAST)
+			block = B_NONE;
+
+		color = WORLD_THUMB_COLORS[block];
+
+		// darken walls like the wall sprites
+		if ((cell & WORLDFILE_THUMB_WALL) && block != B_NONE)
+			color = ((color >> 24) * 175 / 255) << 24 |
+			    ((color >> 16 & 0xff) * 175 / 255) << 16 |
+			    ((color >> 8 & 0xff) * 175 / 255) << 8 | 0xff;
+
+		pixels[i] = color;
+	}
+
+	SDL_UpdateTexture(texture, NULL, pixels,
+			  WORLDFILE_THUMB_W * sizeof(uint32_t));
+}
+
+/* fills the world buttons with the current page of the catalog */
+static void world_list_update(WorldListData * data)
+{
+	const size_t pages = data->catalog.len == 0 ? 1 :
+	    (data->catalog.len + WORLD_LIST_LEN - 1) / WORLD_LIST_LEN;
+	const CatalogEntry *entry;
+	SGUI_Button *btn;
+
+	for (size_t i = 0; i < WORLD_LIST_LEN; i++) {
+		btn = &data->btn_worlds[i];
+		entry = NULL;
+
+		if (data->page * WORLD_LIST_LEN + i < data->catalog.len)
+			entry = &data->catalog.entries[data->page *
+						       WORLD_LIST_LEN + i];
+
+		if (entry == NULL)
+			sprintf(data->text, "-");
+		else if (entry->version == 0)
+			sprintf(data->text, "%s (old format)", entry->name);
+		else
+			sprintf(data->text, "%s (%ux%u)", entry->name,
+				entry->width, entry->height);
+
+		SM_String_copy_cstr(&btn->text, data->text);
+		SGUI_Button_update_sprite(btn);
+		btn->rect.w = btn->sprite.surface->w;
+		btn->rect.h = btn->sprite.surface->h;
+		btn->disabled = entry == NULL;
+
+		if (data->thumbs[i] != NULL)
+			world_thumb_update(data->thumbs[i], entry);
+	}
+
+	sprintf(data->text, "%zu / %zu", data->page + 1, pages);
+	SM_String_copy_cstr(&data->lbl_page->text, data->text);
+	SGUI_Label_update_sprite(data->lbl_page);
+	data->lbl_page->rect.w = data->lbl_page->sprite.surface->w;
+	data->lbl_page->rect.h = data->lbl_page->sprite.surface->h;
+}
+
 void btn_start_game_click(void *ptr)
 {
-	MenuData *data = (MenuData *) ptr;
+	WorldListData *data = (WorldListData *) ptr;
 
 	// toggle menus, clear event
-	data->mnu_main->visible = false;
-	data->mnu_start_game->visible = true;
-	data->event->type = SDL_USEREVENT;
+	data->menu_data->mnu_main->visible = false;
+	data->menu_data->mnu_start_game->visible = true;
+	data->menu_data->event->type = SDL_USEREVENT;
+
+	// list worlds, only changed files get opened
+	Catalog_clear(&data->catalog);
+	data->catalog = Catalog_load();
+	data->page = 0;
+
+	if (data->catalog.invalid)
+		SM_log_err("Worlds could not be listed.");
+
+	world_list_update(data);
+}
+
+void btn_worlds_prev_click(void *ptr)
+{
+	WorldListData *data = (WorldListData *) ptr;
+
+	if (data->page > 0) {
+		data->page--;
+		world_list_update(data);
+	}
+
+	data->menu_data->event->type = SDL_USEREVENT;
+}
+
+void btn_worlds_next_click(void *ptr)
+{
+	WorldListData *data = (WorldListData *) ptr;
+
+	if ((data->page + 1) * WORLD_LIST_LEN < data->catalog.len) {
+		data->page++;
+		world_list_update(data);
+	}
+
+	data->menu_data->event->type = SDL_USEREVENT;
 }
 
 void btn_editor_click(void *ptr)
@@ -262,11 +396,17 @@ void btn_license_close_click(void *ptr)
 	data->event->type = SDL_USEREVENT;
 }
 
-void btn_chapter1_click(void *ptr)
+void btn_world_click(void *ptr)
 {
-	Game *data = (Game *) ptr;
+	BtnWorldData *data = (BtnWorldData *) ptr;
+	WorldListData *list = data->list;
+	const size_t i = list->page * WORLD_LIST_LEN + data->slot;
+
+	if (i >= list->catalog.len)
+		return;
 
-	Game_run(data);
+	list->game->world_name = list->catalog.entries[i].name;
+	Game_run(list->game);
 }
 
 void btn_start_edit_click(void *ptr)
@@ -287,53 +427,53 @@ void btn_start_edit_click(void *ptr)
 #include "entity.h"
 void gen_demo_horizontal(void)
 {
-	SG_World out = World_new(128, 128);
+	World out = World_new(128, 128);
 
-	out.blocks[0][0][0] = B_STONE;
-	out.blocks[0][1][0] = B_STONE;
-	out.blocks[0][5][0] = B_DIRT;
+	World_set_block(&out, 0, 0, L_BLOCK, B_STONE);
+	World_set_block(&out, 0, 1, L_BLOCK, B_STONE);
+	World_set_block(&out, 0, 5, L_BLOCK, B_DIRT);
 
-	out.blocks[1][5][0] = B_DIRT;
-	out.blocks[1][6][0] = B_STONE;
+	World_set_block(&out, 1, 5, L_BLOCK, B_DIRT);
+	World_set_block(&out, 1, 6, L_BLOCK, B_STONE);
 
-	out.blocks[2][5][0] = B_DIRT;
-	out.blocks[2][6][0] = B_STONE;
+	World_set_block(&out, 2, 5, L_BLOCK, B_DIRT);
+	World_set_block(&out, 2, 6, L_BLOCK, B_STONE);
 
-	out.blocks[3][5][0] = B_DIRT;
-	out.blocks[3][6][0] = B_STONE;
+	World_set_block(&out, 3, 5, L_BLOCK, B_DIRT);
+	World_set_block(&out, 3, 6, L_BLOCK, B_STONE);
 
-	out.blocks[4][5][0] = B_DIRT;
-	out.blocks[4][6][0] = B_STONE;
+	World_set_block(&out, 4, 5, L_BLOCK, B_DIRT);
+	World_set_block(&out, 4, 6, L_BLOCK, B_STONE);
 
-	out.blocks[5][5][0] = B_DIRT;
-	out.blocks[5][6][0] = B_STONE;
+	World_set_block(&out, 5, 5, L_BLOCK, B_DIRT);
+	World_set_block(&out, 5, 6, L_BLOCK, B_STONE);
 
-	out.blocks[6][6][0] = B_STONE;
+	World_set_block(&out, 6, 6, L_BLOCK, B_STONE);
 
-	out.blocks[7][6][0] = B_STONE;
+	World_set_block(&out, 7, 6, L_BLOCK, B_STONE);
 
-	out.blocks[10][0][0] = B_STONE;
-	out.blocks[10][1][0] = B_STONE;
+	World_set_block(&out, 10, 0, L_BLOCK, B_STONE);
+	World_set_block(&out, 10, 1, L_BLOCK, B_STONE);
 
-	out.blocks[0][3][1] = B_DIRT;
-	out.blocks[0][4][1] = B_DIRT;
+	World_set_block(&out, 0, 3, L_WALL, B_DIRT);
+	World_set_block(&out, 0, 4, L_WALL, B_DIRT);
 
-	out.blocks[1][3][1] = B_DIRT;
-	out.blocks[1][4][1] = B_DIRT;
+	World_set_block(&out, 1, 3, L_WALL, B_DIRT);
+	World_set_block(&out, 1, 4, L_WALL, B_DIRT);
 
-	out.blocks[2][3][1] = B_DIRT;
-	out.blocks[2][4][1] = B_DIRT;
+	World_set_block(&out, 2, 3, L_WALL, B_DIRT);
+	World_set_block(&out, 2, 4, L_WALL, B_DIRT);
 
-	out.blocks[3][3][1] = B_DIRT;
-	out.blocks[3][4][1] = B_DIRT;
+	World_set_block(&out, 3, 3, L_WALL, B_DIRT);
+	World_set_block(&out, 3, 4, L_WALL, B_DIRT);
 
-	out.blocks[4][4][1] = B_DIRT;
+	World_set_block(&out, 4, 4, L_WALL, B_DIRT);
 
 	out.entities[0].rect.x = 2.0f * (float)BLOCK_SIZE;
 	out.entities[0].rect.y = 1.0f * (float)BLOCK_SIZE;
 
-	World_write(&out, "test");
-	SG_World_clear(&out);
+	World_write(&out, "test", false);
+	World_clear(&out);
 }
 
 int main()
@@ -360,7 +500,12 @@ int main()
 
 	SGUI_Menu mnu_start_game;
 	SGUI_Button btn_start_game_close;
-	SGUI_Button btn_chapter1;
+	SGUI_Button btn_worlds[WORLD_LIST_LEN];
+	SGUI_Button btn_worlds_prev;
+	SGUI_Label lbl_worlds_page;
+	SGUI_Button btn_worlds_next;
+	BtnWorldData btn_world_data[WORLD_LIST_LEN];
+	SDL_Rect rect_thumb;
 
 	SGUI_Menu mnu_editor;
 	SGUI_Button btn_editor_close;
@@ -398,6 +543,14 @@ int main()
 		.mnu_license = &mnu_license,
 	};
 
+	WorldListData world_list_data = {
+		.menu_data = &menu_data,
+		.catalog = {.invalid = true },
+		.page = 0,
+		.btn_worlds = btn_worlds,
+		.lbl_page = &lbl_worlds_page,
+	};
+
 	BtnSettingsData btn_settings_data = {
 		.cfg = &cfg,
 		.menu_data = &menu_data,
@@ -462,11 +615,13 @@ int main()
 	}
 	// game data
 	Game game = {
-		.world_name = "test",
+		.world_name = NULL,
 		.renderer = renderer,
 		.cfg = &cfg,
 	};
 
+	world_list_data.game = &game;
+
 	BtnStartEditData btn_start_edit_data = {
 		.game = {
 			 .renderer = renderer,
@@ -494,7 +649,17 @@ int main()
 	mnu_start_game = SGUI_Menu_new(renderer, THEME_SUB.menu);
 	SGUI_Button_new(&btn_start_game_close, &mnu_start_game, font,
 			THEME_SUB.button);
-	SGUI_Button_new(&btn_chapter1, &mnu_start_game, font, THEME_SUB.button);
+
+	for (size_t i = 0; i < WORLD_LIST_LEN; i++)
+		SGUI_Button_new(&btn_worlds[i], &mnu_start_game, font,
+				THEME_SUB.button);
+
+	SGUI_Button_new(&btn_worlds_prev, &mnu_start_game, font,
+			THEME_SUB.button);
+	SGUI_Label_new(&lbl_worlds_page, &mnu_start_game, font,
+		       THEME_SUB.label);
+	SGUI_Button_new(&btn_worlds_next, &mnu_start_game, font,
+			THEME_SUB.button);
 
 	mnu_editor = SGUI_Menu_new(renderer, THEME_SUB.menu);
 	SGUI_Button_new(&btn_editor_close, &mnu_editor, font, THEME_SUB.button);
@@ -567,7 +732,7 @@ int main()
 	btn_start_game.rect.x = mnu_main.rect.x;
 	btn_start_game.rect.y = mnu_main.rect.y;
 	btn_start_game.func_click = btn_start_game_click;
-	btn_start_game.data_click = &menu_data;
+	btn_start_game.data_click = &world_list_data;
 
 	SM_String_copy_cstr(&btn_editor.text, "Editor ->");
 	SGUI_Button_update_sprite(&btn_editor);
@@ -612,15 +777,53 @@ int main()
 	btn_start_game_close.func_click = btn_start_game_close_click;
 	btn_start_game_close.data_click = &menu_data;
 
-	SM_String_copy_cstr(&btn_chapter1.text, "Chapter 1: Test");
-	SGUI_Button_update_sprite(&btn_chapter1);
-	btn_chapter1.rect.w = btn_chapter1.sprite.surface->w;
-	btn_chapter1.rect.h = btn_chapter1.sprite.surface->h;
-	btn_chapter1.rect.x = mnu_start_game.rect.x;
-	btn_chapter1.rect.y =
-	    btn_start_game_close.rect.y + btn_start_game_close.rect.h;
-	btn_chapter1.func_click = btn_chapter1_click;
-	btn_chapter1.data_click = &game;
+	// world list, one row per world with its thumbnail in front
+	for (size_t i = 0; i < WORLD_LIST_LEN; i++) {
+		world_list_data.thumbs[i] =
+		    SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+				      SDL_TEXTUREACCESS_STATIC,
+				      WORLDFILE_THUMB_W, WORLDFILE_THUMB_H);
+
+		btn_world_data[i].list = &world_list_data;
+		btn_world_data[i].slot = i;
+
+		SM_String_copy_cstr(&btn_worlds[i].text, "-");
+		SGUI_Button_update_sprite(&btn_worlds[i]);
+		btn_worlds[i].rect.w = btn_worlds[i].sprite.surface->w;
+		btn_worlds[i].rect.h = btn_worlds[i].sprite.surface->h;
+		btn_worlds[i].rect.x = mnu_start_game.rect.x + WORLD_THUMB_W + 4;
+		btn_worlds[i].rect.y = btn_start_game_close.rect.y +
+		    btn_start_game_close.rect.h + i * (WORLD_THUMB_H + 4);
+		btn_worlds[i].func_click = btn_world_click;
+		btn_worlds[i].data_click = &btn_world_data[i];
+	}
+
+	SM_String_copy_cstr(&btn_worlds_prev.text, "<");
+	SGUI_Button_update_sprite(&btn_worlds_prev);
+	btn_worlds_prev.rect.w = btn_worlds_prev.sprite.surface->w;
+	btn_worlds_prev.rect.h = btn_worlds_prev.sprite.surface->h;
+	btn_worlds_prev.rect.x = mnu_start_game.rect.x;
+	btn_worlds_prev.rect.y = btn_worlds[WORLD_LIST_LEN - 1].rect.y +
+	    WORLD_THUMB_H + 4;
+	btn_worlds_prev.func_click = btn_worlds_prev_click;
+	btn_worlds_prev.data_click = &world_list_data;
+
+	SM_String_copy_cstr(&lbl_worlds_page.text, "1 / 1");
+	SGUI_Label_update_sprite(&lbl_worlds_page);
+	lbl_worlds_page.rect.w = lbl_worlds_page.sprite.surface->w;
+	lbl_worlds_page.rect.h = lbl_worlds_page.sprite.surface->h;
+	lbl_worlds_page.rect.x =
+	    btn_worlds_prev.rect.x + btn_worlds_prev.rect.w + 8;
+	lbl_worlds_page.rect.y = btn_worlds_prev.rect.y;
+
+	SM_String_copy_cstr(&btn_worlds_next.text, ">");
+	SGUI_Button_update_sprite(&btn_worlds_next);
+	btn_worlds_next.rect.w = btn_worlds_next.sprite.surface->w;
+	btn_worlds_next.rect.h = btn_worlds_next.sprite.surface->h;
+	btn_worlds_next.rect.x = mnu_start_game.rect.x + WORLD_THUMB_W + 4;
+	btn_worlds_next.rect.y = btn_worlds_prev.rect.y;
+	btn_worlds_next.func_click = btn_worlds_next_click;
+	btn_worlds_next.data_click = &world_list_data;
 
 	// mnu_editor
 	mnu_editor.rect.x = MNU_SUB_X;
@@ -840,6 +1043,23 @@ int main()
 			SGUI_Menu_draw(&mnu_settings);
 			SGUI_Menu_draw(&mnu_license);
 
+			// world thumbnails, next to their buttons
+			if (mnu_start_game.visible) {
+				for (size_t i = 0; i < WORLD_LIST_LEN; i++) {
+					if (btn_worlds[i].disabled)
+						continue;
+
+					rect_thumb.x = mnu_start_game.rect.x;
+					rect_thumb.y = btn_worlds[i].rect.y;
+					rect_thumb.w = WORLD_THUMB_W;
+					rect_thumb.h = WORLD_THUMB_H;
+
+					SDL_RenderCopy(renderer,
+						       world_list_data.thumbs
+						       [i], NULL, &rect_thumb);
+				}
+			}
+
 			SDL_RenderPresent(renderer);
 
 			ts_draw = now();
@@ -855,6 +1075,13 @@ int main()
 	SM_String_clear(&window_title);
 	SM_String_clear(&msg);
 
+	// clear world list
+	Catalog_clear(&world_list_data.catalog);
+
+	for (size_t i = 0; i < WORLD_LIST_LEN; i++)
+		if (world_list_data.thumbs[i] != NULL)
+			SDL_DestroyTexture(world_list_data.thumbs[i]);
+
 	// clear menus
 	SGUI_Menu_clear(&mnu_master);
 	SGUI_Menu_clear(&mnu_main);
@@ -0,0 +1,123 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#include <SM_log.h>
+#include "pacer.h"
+
+/*
+	A mode out of range falls back to vsync, vsync the renderer can not
+	do falls back to the cap, a cap of 0 or less means uncapped.
+*/
+FramePacer FramePacer_new(SDL_Renderer * renderer, const int32_t mode,
+			  const int32_t cap)
+{
+	FramePacer pacer = {
+		.mode = (mode >= 0 && mode <= PM_LAST) ? mode : PM_VSYNC,
+		.freq = SDL_GetPerformanceFrequency(),
+		.frames = 0,
+		.sum = 0.0,
+		.change = 0.0,
+		.prev = 0.0,
+		.worst = 0.0,
+		.stats = {.mean = 0.0f,.jitter = 0.0f,.worst = 0.0f},
+	};
+
+	if (pacer.mode == PM_VSYNC && SDL_RenderSetVSync(renderer, 1) != 0) {
+		SM_log_warn("Vsync is not available, frames get capped.");
+		pacer.mode = PM_CAP;
+	}
+
+	if (pacer.mode == PM_CAP && cap <= 0)
+		pacer.mode = PM_UNCAPPED;
+
+	if (pacer.mode != PM_VSYNC)
+		SDL_RenderSetVSync(renderer, 0);
+
+	pacer.period = cap > 0 ? pacer.freq / cap : 0;
+	pacer.spin = pacer.freq * PACER_SPIN_MS / 1000;
+	pacer.last = SDL_GetPerformanceCounter();
+	pacer.deadline = pacer.last + pacer.period;
+
+	return pacer;
+}
+
+static void FramePacer_count(FramePacer * pacer, const uint64_t ticks)
+{
+	const double ms = (double)ticks * 1000.0 / (double)pacer->freq;
+
+	if (pacer->frames > 0)
+		pacer->change += ms > pacer->prev ?
+		    ms - pacer->prev : pacer->prev - ms;
+
+	if (ms > pacer->worst)
+		pacer->worst = ms;
+
+	pacer->sum += ms;
+	pacer->prev = ms;
+	pacer->frames++;
+
+	if (pacer->frames < PACER_WINDOW)
+		return;
+
+	pacer->stats.mean = pacer->sum / pacer->frames;
+	pacer->stats.jitter = pacer->change / (pacer->frames - 1);
+	pacer->stats.worst = pacer->worst;
+
+	pacer->frames = 0;
+	pacer->sum = 0.0;
+	pacer->change = 0.0;
+	pacer->worst = 0.0;
+}
+
+void FramePacer_wait(FramePacer * pacer)
+{
+	uint64_t t = SDL_GetPerformanceCounter();
+
+	if (pacer->mode == PM_CAP) {
+		// sleep coarse, spin the last few milliseconds
+		if (t + pacer->spin < pacer->deadline)
+			SDL_Delay((pacer->deadline - t - pacer->spin) * 1000 /
+				  pacer->freq);
+
+		while (t < pacer->deadline)
+			t = SDL_GetPerformanceCounter();
+
+		// stay on the frame grid, a frame late starts a new one
+		pacer->deadline += pacer->period;
+
+		if (pacer->deadline < t)
+			pacer->deadline = t + pacer->period;
+	}
+
+	FramePacer_count(pacer, t - pacer->last);
+	pacer->last = t;
+}
+
+void FramePacer_idle(FramePacer * pacer)
+{
+	const uint64_t period = pacer->period > 0 ?
+	    pacer->period : pacer->freq / PACER_IDLE_RATE;
+	const uint64_t t = SDL_GetPerformanceCounter();
+
+	if (t < pacer->last + period)
+		SDL_Delay((pacer->last + period - t) * 1000 / pacer->freq);
+
+	pacer->last = SDL_GetPerformanceCounter();
+	pacer->deadline = pacer->last + pacer->period;
+}
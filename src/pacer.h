@@ -0,0 +1,80 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#ifndef PACER_H
+#define PACER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <SDL_render.h>
+
+/*
+	Paces the game and editor loops, waited on after each present.
+	PM_VSYNC has SDL_RenderPresent wait for the display, PM_CAP sleeps
+	until shortly before the next frame is due and spins the rest, as
+	SDL_Delay may oversleep by a millisecond or more. PM_UNCAPPED never
+	waits, for benchmarks.
+	Frame times are gathered over PACER_WINDOW frames, stats hold those
+	of the last full window. Jitter is the mean change from one frame
+	time to the next.
+	A loop that skips a present waits with FramePacer_idle instead,
+	which sleeps a frame at the cap (PACER_IDLE_RATE without one) in
+	every mode, and is left out of the stats.
+*/
+#define PACER_WINDOW 120
+#define PACER_SPIN_MS 2
+#define PACER_IDLE_RATE 60
+
+typedef enum PacerMode {
+	PM_VSYNC,
+	PM_CAP,
+	PM_UNCAPPED,
+
+	PM_LAST = PM_UNCAPPED,
+} PacerMode;
+
+typedef struct FrameStats {
+	float mean;		/* ms */
+	float jitter;		/* ms */
+	float worst;		/* ms */
+} FrameStats;
+
+typedef struct FramePacer {
+	PacerMode mode;
+	uint64_t freq;
+	uint64_t period;	/* counter ticks per frame, PM_CAP */
+	uint64_t spin;
+	uint64_t deadline;
+	uint64_t last;		/* end of the previous frame */
+	uint32_t frames;
+	double sum;
+	double change;
+	double prev;
+	double worst;
+	FrameStats stats;
+} FramePacer;
+
+FramePacer FramePacer_new(SDL_Renderer * renderer, const int32_t mode,
+			  const int32_t cap);
+
+void FramePacer_wait(FramePacer * pacer);
+
+void FramePacer_idle(FramePacer * pacer);
+
+#endif				// PACER_H
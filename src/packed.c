@@ -0,0 +1,208 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "packed.h"
+
+/* smallest index width for a number of distinct values */
+static uint8_t width_for(const size_t count)
+{
+	if (count <= 1)
+		return 0;
+	else if (count <= 2)
+		return 1;
+	else if (count <= 4)
+		return 2;
+	else if (count <= PACKED_PALETTE_MAX)
+		return 4;
+	else
+		return PACKED_DIRECT;
+}
+
+static uint8_t index_at(const PackedPlane * plane, const size_t i)
+{
+	const size_t bit = i * plane->bits;
+
+	if (plane->bits == 0)
+		return 0;
+
+	return (plane->data[bit >> 3] >> (bit & 7)) & ((1 << plane->bits) - 1);
+}
+
+static void index_put(uint8_t * data, const uint8_t bits, const size_t i,
+		      const uint8_t index)
+{
+	const size_t bit = i * bits;
+	const uint8_t mask = ((1 << bits) - 1) << (bit & 7);
+
+	data[bit >> 3] = (data[bit >> 3] & ~mask) | (index << (bit & 7));
+}
+
+static bool widen(PackedPlane * plane, const size_t area, const uint8_t bits)
+{
+	uint8_t *data = calloc(area * bits / 8, 1);
+
+	if (data == NULL)
+		return false;
+
+	for (size_t i = 0; i < area; i++) {
+		if (bits == PACKED_DIRECT)
+			data[i] = plane->palette[index_at(plane, i)];
+		else
+			index_put(data, bits, i, index_at(plane, i));
+	}
+
+	free(plane->data);
+	plane->data = data;
+	plane->bits = bits;
+
+	return true;
+}
+
+bool PackedPlane_set(PackedPlane * plane, const size_t area, const size_t i,
+		     const uint8_t value)
+{
+	uint8_t index;
+
+	if (plane->bits == PACKED_DIRECT) {
+		plane->data[i] = value;
+		return true;
+	}
+
+	for (index = 0; index < plane->len; index++)
+		if (plane->palette[index] == value)
+			break;
+
+	// new value, widen once the palette is out of indices
+	if (index == plane->len) {
+		if (plane->len == (1 << plane->bits)) {
+			if (!widen(plane, area, width_for(plane->len + 1)))
+				return false;
+
+			if (plane->bits == PACKED_DIRECT) {
+				plane->data[i] = value;
+				return true;
+			}
+		}
+
+		plane->palette[plane->len++] = value;
+	}
+
+	if (plane->bits > 0)
+		index_put(plane->data, plane->bits, i, index);
+
+	return true;
+}
+
+bool PackedPlane_pack(PackedPlane * plane, const size_t area,
+		      const uint8_t * src)
+{
+	uint8_t lookup[256];
+	bool seen[256] = { false };
+	size_t count = 0;
+	uint8_t bits;
+	uint8_t *data = NULL;
+
+	// palette in order of appearance
+	for (size_t i = 0; i < area; i++) {
+		if (seen[src[i]])
+			continue;
+
+		seen[src[i]] = true;
+
+		if (count < PACKED_PALETTE_MAX) {
+			plane->palette[count] = src[i];
+			lookup[src[i]] = count;
+		}
+
+		count++;
+	}
+
+	bits = width_for(count);
+
+	if (bits > 0) {
+		data = calloc(area * bits / 8, 1);
+
+		if (data == NULL)
+			return false;
+	}
+
+	if (bits == PACKED_DIRECT)
+		memcpy(data, src, area);
+	else if (bits > 0)
+		for (size_t i = 0; i < area; i++)
+			index_put(data, bits, i, lookup[src[i]]);
+
+	plane->bits = bits;
+	plane->len = bits == PACKED_DIRECT ? 0 : count;
+	plane->data = data;
+
+	return true;
+}
+
+void PackedPlane_unpack(const PackedPlane * plane, const size_t area,
+			uint8_t * dst)
+{
+	if (plane->bits == 0)
+		memset(dst, plane->palette[0], area);
+	else if (plane->bits == PACKED_DIRECT)
+		memcpy(dst, plane->data, area);
+	else
+		for (size_t i = 0; i < area; i++)
+			dst[i] = plane->palette[index_at(plane, i)];
+}
+
+void PackedPlane_fill(PackedPlane * plane, const uint8_t value)
+{
+	free(plane->data);
+
+	plane->bits = 0;
+	plane->len = 1;
+	plane->palette[0] = value;
+	plane->data = NULL;
+}
+
+/* gives the plane its own copy of the index data */
+bool PackedPlane_copy(PackedPlane * plane, const size_t area)
+{
+	uint8_t *data;
+
+	if (plane->data == NULL)
+		return true;
+
+	data = malloc(PackedPlane_size(plane, area));
+
+	if (data == NULL)
+		return false;
+
+	memcpy(data, plane->data, PackedPlane_size(plane, area));
+	plane->data = data;
+
+	return true;
+}
+
+void PackedPlane_clear(PackedPlane * plane)
+{
+	free(plane->data);
+
+	plane->bits = 0;
+	plane->len = 0;
+	plane->data = NULL;
+}
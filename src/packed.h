@@ -0,0 +1,81 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+	One layer of one chunk, stored as palette indices.
+	Indices are 0, 1, 2 or 4 bits wide, packed little end first.
+	A plane that needs more than PACKED_PALETTE_MAX values stores
+	them directly at 8 bits.
+	Width only ever grows on set, PackedPlane_pack picks the smallest.
+*/
+#define PACKED_PALETTE_MAX 16
+#define PACKED_DIRECT 8
+
+typedef struct PackedPlane {
+	uint8_t bits;
+	uint8_t len;
+	uint8_t palette[PACKED_PALETTE_MAX];
+	uint8_t *data;
+} PackedPlane;
+
+static inline uint8_t PackedPlane_get(const PackedPlane * plane, size_t i)
+{
+	size_t bit;
+
+	if (plane->bits == 0)
+		return plane->palette[0];
+
+	if (plane->bits == PACKED_DIRECT)
+		return plane->data[i];
+
+	bit = i * plane->bits;
+
+	return plane->palette[(plane->data[bit >> 3] >> (bit & 7)) &
+			      ((1 << plane->bits) - 1)];
+}
+
+static inline size_t PackedPlane_size(const PackedPlane * plane,
+				      const size_t area)
+{
+	return area * plane->bits / 8;
+}
+
+bool PackedPlane_set(PackedPlane * plane, const size_t area, const size_t i,
+		     const uint8_t value);
+
+bool PackedPlane_pack(PackedPlane * plane, const size_t area,
+		      const uint8_t * src);
+
+void PackedPlane_unpack(const PackedPlane * plane, const size_t area,
+			uint8_t * dst);
+
+void PackedPlane_fill(PackedPlane * plane, const uint8_t value);
+
+bool PackedPlane_copy(PackedPlane * plane, const size_t area);
+
+void PackedPlane_clear(PackedPlane * plane);
+
+#endif				// PACKED_H
@@ -89,6 +89,24 @@ int32_t get_world_path(SM_String * out)
 	return 0;
 }
 
+int32_t get_world_filepath(SM_String * out, const char *world_name)
+{
+	int32_t rc;
+
+	/* get worlds dir */
+	rc = get_world_path(out);
+
+	if (rc != 0)
+		return rc;
+
+	/* get path */
+	SM_String_append_cstr(out, world_name);
+	SM_String_append_cstr(out, ".");
+	SM_String_append_cstr(out, FILETYPE_WORLD);
+
+	return 0;
+}
+
 int32_t get_config_path(SM_String * out)
 {
 	int32_t rc;
@@ -105,6 +123,24 @@ int32_t get_config_path(SM_String * out)
 	return 0;
 }
 
+int32_t get_catalog_path(SM_String * out)
+{
+	int32_t rc;
+
+	/* get worlds dir */
+	rc = get_world_path(out);
+
+	if (rc != 0)
+		return rc;
+
+	/* get path */
+	SM_String_append_cstr(out, PATH_CATALOG);
+	SM_String_append_cstr(out, ".");
+	SM_String_append_cstr(out, FILETYPE_CATALOG);
+
+	return 0;
+}
+
 bool file_check_existence(const char *path)
 {
 	FILE *f = fopen(path, "r");
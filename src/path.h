@@ -32,17 +32,23 @@ static const char SLASH[] = "/";
 
 static const char PATH_WORLDS[] = "worlds";
 static const char PATH_CONFIG[] = "config.cfg";
+static const char PATH_CATALOG[] = "catalog";
 static const char PATH_TEXTURE_ICON[] = PATH_TEXTURES "icon.png";
 
 static const char FILETYPE_WORLD[] = "wld";
 static const char FILETYPE_BACKUP[] = "bkp";
+static const char FILETYPE_CATALOG[] = "idx";
 
 int32_t get_base_path(SM_String * out);
 
 int32_t get_world_path(SM_String * out);
 
+int32_t get_world_filepath(SM_String * out, const char *world_name);
+
 int32_t get_config_path(SM_String * out);
 
+int32_t get_catalog_path(SM_String * out);
+
 bool file_check_existence(const char *path);
 
 #endif				/* PATH_H */
@@ -0,0 +1,684 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stream.h"
+#include "entity.h"
+#include "physics.h"
+
+// x, y, w, h, prev_x, prev_y, velocity x and y, max_velocity, decceleration
+#define PHYSICS_FLOATS 10
+
+// fixed_ x, y, w, h, velocity x and y, max_velocity, decceleration
+#define PHYSICS_FIXEDS 8
+
+/* copies the fixed state of entities first to last - 1 to the floats */
+static void Physics_mirror(Physics * phys, const size_t first,
+			   const size_t last)
+{
+	for (size_t i = first; i < last; i++) {
+		phys->x[i] = Fixed_to_float(phys->fixed_x[i]);
+		phys->y[i] = Fixed_to_float(phys->fixed_y[i]);
+		phys->velocity_x[i] = Fixed_to_float(phys->fixed_velocity_x[i]);
+		phys->velocity_y[i] = Fixed_to_float(phys->fixed_velocity_y[i]);
+	}
+}
+
+/* rate 0 runs the physics in float, see Physics */
+Physics Physics_new(const World * world, const int32_t rate)
+{
+	Physics phys = {
+		.invalid = false,
+		.lod_interval = 1,
+		.rate = rate > 0 ? rate : 0,
+	};
+	size_t i = 0;
+
+	for (size_t e = 0; e < world->ent_count; e++)
+		if (world->entities[e].id != E_NONE &&
+		    world->entities[e].id <= E_LAST)
+			phys.len++;
+
+	phys.id = calloc(phys.len, sizeof(uint32_t));
+	phys.x = calloc(phys.len * PHYSICS_FLOATS, sizeof(float));
+	phys.grounded = calloc(phys.len, sizeof(uint8_t));
+	phys.ticks = calloc(phys.len, sizeof(uint8_t));
+	phys.asleep = calloc(phys.len, sizeof(uint8_t));
+
+	if (phys.rate > 0)
+		phys.fixed_x = calloc(phys.len * PHYSICS_FIXEDS, sizeof(Fixed));
+
+	if (phys.len > 0 && (phys.id == NULL || phys.x == NULL ||
+			     phys.grounded == NULL || phys.ticks == NULL ||
+			     phys.asleep == NULL ||
+			     (phys.rate > 0 && phys.fixed_x == NULL))) {
+		Physics_clear(&phys);
+		phys.invalid = true;
+		return phys;
+	}
+
+	phys.y = phys.x + phys.len;
+	phys.w = phys.y + phys.len;
+	phys.h = phys.w + phys.len;
+	phys.prev_x = phys.h + phys.len;
+	phys.prev_y = phys.prev_x + phys.len;
+	phys.velocity_x = phys.prev_y + phys.len;
+	phys.velocity_y = phys.velocity_x + phys.len;
+	phys.max_velocity = phys.velocity_y + phys.len;
+	phys.decceleration = phys.max_velocity + phys.len;
+
+	if (phys.rate > 0) {
+		phys.fixed_y = phys.fixed_x + phys.len;
+		phys.fixed_w = phys.fixed_y + phys.len;
+		phys.fixed_h = phys.fixed_w + phys.len;
+		phys.fixed_velocity_x = phys.fixed_h + phys.len;
+		phys.fixed_velocity_y = phys.fixed_velocity_x + phys.len;
+		phys.fixed_max_velocity = phys.fixed_velocity_y + phys.len;
+		phys.fixed_decceleration = phys.fixed_max_velocity + phys.len;
+	}
+
+	for (size_t e = 0; e < world->ent_count; e++) {
+		const SG_Entity *ent = &world->entities[e];
+
+		if (ent->id == E_NONE || ent->id > E_LAST)
+			continue;
+
+		phys.id[i] = ent->id;
+		phys.x[i] = ent->rect.x;
+		phys.y[i] = ent->rect.y;
+		phys.w[i] = ent->rect.w;
+		phys.h[i] = ent->rect.h;
+		phys.prev_x[i] = ent->rect.x;
+		phys.prev_y[i] = ent->rect.y;
+		phys.velocity_x[i] = ent->velocity_x;
+		phys.velocity_y[i] = ent->velocity_y;
+		phys.max_velocity[i] = DATA_ENTITIES[ent->id].max_velocity;
+		phys.decceleration[i] = DATA_ENTITIES[ent->id].decceleration;
+		phys.grounded[i] = ent->grounded;
+
+		if (phys.rate > 0) {
+			phys.fixed_x[i] = Fixed_from_float(ent->rect.x);
+			phys.fixed_y[i] = Fixed_from_float(ent->rect.y);
+			phys.fixed_w[i] = Fixed_from_float(ent->rect.w);
+			phys.fixed_h[i] = Fixed_from_float(ent->rect.h);
+			phys.fixed_velocity_x[i] =
+			    Fixed_from_float(ent->velocity_x);
+			phys.fixed_velocity_y[i] =
+			    Fixed_from_float(ent->velocity_y);
+			phys.fixed_max_velocity[i] =
+			    Fixed_from_float(DATA_ENTITIES[ent->id].
+					     max_velocity);
+			phys.fixed_decceleration[i] =
+			    Fixed_from_float(DATA_ENTITIES[ent->id].
+					     decceleration) / phys.rate;
+		}
+
+		i++;
+	}
+
+	// start from the rounded state, so drawing matches the first step
+	if (phys.rate > 0) {
+		Physics_mirror(&phys, 0, phys.len);
+		memcpy(phys.prev_x, phys.x, phys.len * sizeof(float));
+		memcpy(phys.prev_y, phys.y, phys.len * sizeof(float));
+	}
+
+	return phys;
+}
+
+/* false if the world is too large for fixed point positions */
+bool Physics_fixed_fits(const World * world)
+{
+	const size_t max = FIXED_LIMIT / FIXED_ONE / BLOCK_SIZE;
+
+	return world->width <= max && world->height <= max;
+}
+
+/*
+	Adds acceleration x, y (px/s^2) for one step of dt seconds to entity
+	i and wakes it. In fixed point mode the step is 1 / rate.
+*/
+void Physics_accelerate(Physics * phys, const size_t i, const float x,
+			const float y, const float dt)
+{
+	Physics_wake(phys, i);
+
+	if (phys->rate > 0) {
+		phys->fixed_velocity_x[i] += Fixed_from_float(x) / phys->rate;
+		phys->fixed_velocity_y[i] += Fixed_from_float(y) / phys->rate;
+		Physics_mirror(phys, i, i + 1);
+		return;
+	}
+
+	phys->velocity_x[i] += x * dt;
+	phys->velocity_y[i] += y * dt;
+}
+
+/* adds velocity x, y (px/s) to entity i at once and wakes it */
+void Physics_impulse(Physics * phys, const size_t i, const float x,
+		     const float y)
+{
+	Physics_wake(phys, i);
+
+	if (phys->rate > 0) {
+		phys->fixed_velocity_x[i] += Fixed_from_float(x);
+		phys->fixed_velocity_y[i] += Fixed_from_float(y);
+		Physics_mirror(phys, i, i + 1);
+		return;
+	}
+
+	phys->velocity_x[i] += x;
+	phys->velocity_y[i] += y;
+}
+
+/* false if the rect or a chunk around it is not streamed in */
+static bool Physics_loaded(const World * world, const float x, const float y,
+			   const float w, const float h)
+{
+	const float chunk = BLOCK_SIZE * WORLD_CHUNK_SIZE;
+	float x1, y1, x2, y2;
+
+	if (world->stream == NULL)
+		return true;
+
+	x1 = floorf(x / chunk) - 1.0f;
+	y1 = floorf(y / chunk) - 1.0f;
+	x2 = floorf((x + w) / chunk) + 1.0f;
+	y2 = floorf((y + h) / chunk) + 1.0f;
+
+	if (x1 < 0.0f)
+		x1 = 0.0f;
+
+	if (y1 < 0.0f)
+		y1 = 0.0f;
+
+	if (x2 > (float)world->chunks_w - 1.0f)
+		x2 = (float)world->chunks_w - 1.0f;
+
+	if (y2 > (float)world->chunks_h - 1.0f)
+		y2 = (float)world->chunks_h - 1.0f;
+
+	for (size_t cy = (size_t) y1; (float)cy <= y2; cy++)
+		for (size_t cx = (size_t) x1; (float)cx <= x2; cx++)
+			if (!WorldStream_resident
+			    (world, cy * world->chunks_w + cx))
+				return false;
+
+	return true;
+}
+
+/* steps of time entity i covers in this step, see Physics */
+static uint8_t Physics_ticks(const Physics * phys, const World * world,
+			     const SG_FRect * view, const size_t i)
+{
+	const float d = phys->lod_distance;
+	uint8_t ticks = 1;
+
+	if (phys->asleep[i])
+		return 0;
+
+	// far off the view, whole intervals, staggered so each step has some
+	if (view != NULL && phys->lod_interval > 1 &&
+	    (phys->x[i] + phys->w[i] < view->x - d ||
+	     phys->x[i] > view->x + view->w + d ||
+	     phys->y[i] + phys->h[i] < view->y - d ||
+	     phys->y[i] > view->y + view->h + d))
+		ticks = (phys->step + i) % phys->lod_interval == 0 ?
+		    phys->lod_interval : 0;
+
+	if (ticks > 0 && !Physics_loaded(world, phys->x[i], phys->y[i],
+					 phys->w[i], phys->h[i]))
+		return 0;
+
+	return ticks;
+}
+
+/*
+	Passes of Physics_integrate in fixed point. Every array is only
+	accessed through the restrict pointers below while they live, ticks
+	are written before and the float copies mirrored after.
+*/
+static void Physics_integrate_fixed(Physics * phys, const size_t first,
+				    const size_t last)
+{
+	Fixed *restrict velocity_x = phys->fixed_velocity_x;
+	Fixed *restrict velocity_y = phys->fixed_velocity_y;
+	const Fixed *restrict max_velocity = phys->fixed_max_velocity;
+	const Fixed *restrict decceleration = phys->fixed_decceleration;
+	const uint8_t *restrict grounded = phys->grounded;
+	const uint8_t *restrict ticks = phys->ticks;
+	const Fixed gravity = Fixed_from_float(ENTITY_GRAVITY) / phys->rate;
+	const Fixed threshold = Fixed_from_float(ENTITY_VELOCITY_THRESHOLD);
+
+	for (size_t i = first; i < last; i++)
+		velocity_y[i] += gravity * ticks[i];
+
+	for (size_t i = first; i < last; i++) {
+		const Fixed v = velocity_x[i];
+		const Fixed ground = grounded[i];
+		const Fixed friction = decceleration[i] * ticks[i] * ground;
+		const Fixed stop = threshold * ground;
+		Fixed slowed = v > 0 ? v - friction : v + friction;
+
+		// friction never pushes through 0
+		slowed = (((v > 0) & (slowed > stop)) |
+			  ((v < 0) & (slowed < -stop))) ? slowed : 0;
+
+		slowed = slowed > max_velocity[i] ? max_velocity[i] : slowed;
+		velocity_x[i] =
+		    slowed < -max_velocity[i] ? -max_velocity[i] : slowed;
+	}
+}
+
+/* passes of Physics_integrate in float, restrict as in the fixed ones */
+static void Physics_integrate_float(Physics * phys, const float dt,
+				    const size_t first, const size_t last)
+{
+	float *restrict velocity_x = phys->velocity_x;
+	float *restrict velocity_y = phys->velocity_y;
+	const float *restrict max_velocity = phys->max_velocity;
+	const float *restrict decceleration = phys->decceleration;
+	const uint8_t *restrict grounded = phys->grounded;
+	const uint8_t *restrict ticks = phys->ticks;
+
+	// gravity, flags are 0 or 1 so every pass stays free of branches
+	for (size_t i = first; i < last; i++)
+		velocity_y[i] += ENTITY_GRAVITY * dt * ticks[i];
+
+	/*
+	   walking friction towards 0 on ground, stop at velocity threshold,
+	   then clamp to the max velocity of the type
+	 */
+	for (size_t i = first; i < last; i++) {
+		const float v = velocity_x[i];
+		const float ground = grounded[i];
+		const float friction =
+		    decceleration[i] * dt * ticks[i] * ground;
+		const float stop = ENTITY_VELOCITY_THRESHOLD * ground;
+		float slowed = v - copysignf(friction, v);
+
+		// friction never pushes through 0
+		slowed = (slowed * v > 0.0f) & (fabsf(slowed) > stop) ?
+		    slowed : 0.0f;
+
+		slowed = slowed > max_velocity[i] ? max_velocity[i] : slowed;
+		velocity_x[i] =
+		    slowed < -max_velocity[i] ? -max_velocity[i] : slowed;
+	}
+}
+
+/* gravity, friction and clamping for entities first to last - 1 */
+static void Physics_integrate(Physics * phys, const World * world,
+			      const float dt, const SG_FRect * view,
+			      const size_t first, const size_t last)
+{
+	memcpy(&phys->prev_x[first], &phys->x[first],
+	       (last - first) * sizeof(float));
+	memcpy(&phys->prev_y[first], &phys->y[first],
+	       (last - first) * sizeof(float));
+
+	for (size_t i = first; i < last; i++)
+		phys->ticks[i] = Physics_ticks(phys, world, view, i);
+
+	// the float copies are exact enough for chunk borders
+	if (phys->rate > 0) {
+		Physics_integrate_fixed(phys, first, last);
+		Physics_mirror(phys, first, last);
+	} else {
+		Physics_integrate_float(phys, dt, first, last);
+	}
+}
+
+/* distance of entity i at velocity v over its ticks of 1 / rate */
+static Fixed Physics_fixed_distance(const Physics * phys, const size_t i,
+				    const Fixed v)
+{
+	return (Fixed) ((int64_t) v * phys->ticks[i] / phys->rate);
+}
+
+/* Physics_resolve in fixed point, steps are 1 / rate long */
+static void Physics_resolve_fixed(Physics * phys, const World * world,
+				  const uint32_t * order, const size_t first,
+				  const size_t last)
+{
+	Fixed *velocity_x = phys->fixed_velocity_x;
+	Fixed *velocity_y = phys->fixed_velocity_y;
+	FixedRect rect;
+	EntityFixedHit hit;
+	Fixed distance;
+	size_t i;
+
+	for (size_t j = first; j < last; j++) {
+		i = order != NULL ? order[j] : j;
+
+		if (phys->ticks[i] == 0)
+			continue;
+
+		rect.x = phys->fixed_x[i];
+		rect.y = phys->fixed_y[i];
+		rect.w = phys->fixed_w[i];
+		rect.h = phys->fixed_h[i];
+
+		if (velocity_x[i] != 0) {
+			distance =
+			    Physics_fixed_distance(phys, i, velocity_x[i]);
+			hit = Entity_sweep_fixed_x(&rect, distance, world);
+
+			if (hit.hit) {
+				rect.x = hit.pos;
+				velocity_x[i] = 0;
+			} else {
+				rect.x = Fixed_add_limit(rect.x, distance);
+
+				// nothing to stand on out there
+				if (rect.x == FIXED_LIMIT ||
+				    rect.x == -FIXED_LIMIT)
+					velocity_x[i] = 0;
+			}
+
+			phys->fixed_x[i] = rect.x;
+		}
+
+		if (velocity_y[i] != 0) {
+			distance =
+			    Physics_fixed_distance(phys, i, velocity_y[i]);
+			hit = Entity_sweep_fixed_y(&rect, distance, world);
+
+			if (hit.hit) {
+				rect.y = hit.pos;
+				velocity_y[i] = 0;
+			} else {
+				rect.y = Fixed_add_limit(rect.y, distance);
+
+				if (rect.y == FIXED_LIMIT ||
+				    rect.y == -FIXED_LIMIT)
+					velocity_y[i] = 0;
+			}
+
+			phys->fixed_y[i] = rect.y;
+
+			// if falling and collision happened, set grounded
+			phys->grounded[i] = distance > 0 && hit.hit;
+		}
+
+		phys->asleep[i] = phys->grounded[i] && velocity_x[i] == 0;
+		Physics_mirror(phys, i, i + 1);
+	}
+}
+
+/* tile collision for order[first] to order[last - 1], index order if NULL */
+static void Physics_resolve(Physics * phys, const World * world,
+			    const float dt, const uint32_t * order,
+			    const size_t first, const size_t last)
+{
+	SG_FRect rect;
+	EntityHit hit;
+	float distance;
+	float time;
+	size_t i;
+
+	if (phys->rate > 0) {
+		Physics_resolve_fixed(phys, world, order, first, last);
+		return;
+	}
+	// one sweep per axis
+	for (size_t j = first; j < last; j++) {
+		i = order != NULL ? order[j] : j;
+
+		if (phys->ticks[i] == 0)
+			continue;
+
+		time = dt * phys->ticks[i];
+		rect.x = phys->x[i];
+		rect.y = phys->y[i];
+		rect.w = phys->w[i];
+		rect.h = phys->h[i];
+
+		if (phys->velocity_x[i] != 0.0f) {
+			distance = phys->velocity_x[i] * time;
+			hit = Entity_sweep_x(&rect, distance, world);
+
+			if (hit.hit) {
+				rect.x = hit.pos;
+				phys->velocity_x[i] = 0.0f;
+			} else {
+				rect.x += distance;
+			}
+
+			phys->x[i] = rect.x;
+		}
+
+		if (phys->velocity_y[i] != 0.0f) {
+			distance = phys->velocity_y[i] * time;
+			hit = Entity_sweep_y(&rect, distance, world);
+
+			if (hit.hit) {
+				phys->y[i] = hit.pos;
+				phys->velocity_y[i] = 0.0f;
+			} else {
+				phys->y[i] += distance;
+			}
+
+			// if falling and collision happened, set grounded
+			phys->grounded[i] = distance > 0.0f && hit.hit;
+		}
+
+		phys->asleep[i] = phys->grounded[i] &&
+		    phys->velocity_x[i] == 0.0f;
+	}
+}
+
+/* runs part "part" of the current phase of a pool */
+static void PhysicsPool_run(PhysicsPool * pool, const size_t part)
+{
+	const size_t len = pool->phys->len;
+	const size_t first = len * part / pool->parts;
+	const size_t last = len * (part + 1) / pool->parts;
+
+	if (pool->phase == PP_INTEGRATE)
+		Physics_integrate(pool->phys, pool->world, pool->dt,
+				  pool->view, first, last);
+	else
+		Physics_resolve(pool->phys, pool->world, pool->dt, pool->order,
+				first, last);
+}
+
+static int PhysicsPool_worker(void *data)
+{
+	PhysicsWorker *worker = data;
+	PhysicsPool *pool = worker->pool;
+
+	SDL_LockMutex(pool->lock);
+
+	while (true) {
+		while (!pool->quit && pool->generation == worker->generation)
+			SDL_CondWait(pool->wake, pool->lock);
+
+		if (pool->quit)
+			break;
+
+		worker->generation = pool->generation;
+
+		if (worker->part < pool->parts) {
+			SDL_UnlockMutex(pool->lock);
+			PhysicsPool_run(pool, worker->part);
+			SDL_LockMutex(pool->lock);
+		}
+
+		if (--pool->pending == 0)
+			SDL_CondSignal(pool->done);
+	}
+
+	SDL_UnlockMutex(pool->lock);
+
+	return 0;
+}
+
+/* starts the worker threads, runs with fewer if some fail to start */
+static void PhysicsPool_start(PhysicsPool * pool)
+{
+	PhysicsWorker *worker;
+
+	// the calling thread is part 0
+	for (size_t i = 1; i < pool->threads; i++) {
+		worker = &pool->workers[pool->started + 1];
+		worker->pool = pool;
+		worker->part = pool->started + 1;
+		worker->generation = pool->generation;
+		worker->thread =
+		    SDL_CreateThread(PhysicsPool_worker, "physics", worker);
+
+		if (worker->thread == NULL)
+			break;
+
+		pool->started++;
+	}
+
+	pool->threads = pool->started + 1;
+}
+
+/* runs one phase on every thread, returns once all parts are done */
+static void PhysicsPool_phase(PhysicsPool * pool, const PhysicsPhase phase)
+{
+	SDL_LockMutex(pool->lock);
+	pool->phase = phase;
+	pool->pending = pool->started;
+	pool->generation++;
+	SDL_CondBroadcast(pool->wake);
+	SDL_UnlockMutex(pool->lock);
+
+	PhysicsPool_run(pool, 0);
+
+	SDL_LockMutex(pool->lock);
+
+	while (pool->pending > 0)
+		SDL_CondWait(pool->done, pool->lock);
+
+	SDL_UnlockMutex(pool->lock);
+}
+
+/*
+	view is the area the level of detail is measured from, NULL to
+	tick every entity each step.
+	order lists the entities by region (see SpatialHash), it only
+	decides which thread resolves which entity, not the outcome.
+	Without a pool the whole step runs on the calling thread.
+*/
+void Physics_step(Physics * phys, const World * world, const float dt,
+		  const SG_FRect * view, const uint32_t * order,
+		  PhysicsPool * pool)
+{
+	size_t parts = pool != NULL ? phys->len / pool->min_part : 0;
+
+	if (pool != NULL && pool->started == 0 && pool->threads > 1 &&
+	    parts > 1)
+		PhysicsPool_start(pool);
+
+	if (pool == NULL || pool->started == 0 || parts < 2) {
+		Physics_integrate(phys, world, dt, view, 0, phys->len);
+		Physics_resolve(phys, world, dt, order, 0, phys->len);
+		phys->step++;
+		return;
+	}
+
+	pool->parts = parts < pool->started + 1 ? parts : pool->started + 1;
+	pool->phys = phys;
+	pool->world = world;
+	pool->view = view;
+	pool->order = order;
+	pool->dt = dt;
+
+	// integrate everything before any entity moves
+	PhysicsPool_phase(pool, PP_INTEGRATE);
+	PhysicsPool_phase(pool, PP_RESOLVE);
+	phys->step++;
+}
+
+void Physics_clear(Physics * phys)
+{
+	free(phys->id);
+	free(phys->x);
+	free(phys->grounded);
+	free(phys->ticks);
+	free(phys->asleep);
+	free(phys->fixed_x);
+
+	phys->id = NULL;
+	phys->x = NULL;
+	phys->grounded = NULL;
+	phys->ticks = NULL;
+	phys->asleep = NULL;
+	phys->fixed_x = NULL;
+	phys->len = 0;
+}
+
+PhysicsPool PhysicsPool_new(const size_t threads)
+{
+	PhysicsPool pool = {
+		.invalid = false,
+		.threads = threads > 0 ? threads : 1,
+		.min_part = PHYSICS_MIN_PER_THREAD,
+	};
+
+	pool.workers = calloc(pool.threads, sizeof(PhysicsWorker));
+	pool.lock = SDL_CreateMutex();
+	pool.wake = SDL_CreateCond();
+	pool.done = SDL_CreateCond();
+
+	if (pool.workers == NULL || pool.lock == NULL || pool.wake == NULL ||
+	    pool.done == NULL) {
+		PhysicsPool_clear(&pool);
+		pool.invalid = true;
+	}
+
+	return pool;
+}
+
+void PhysicsPool_clear(PhysicsPool * pool)
+{
+	if (pool->started > 0) {
+		SDL_LockMutex(pool->lock);
+		pool->quit = true;
+		SDL_CondBroadcast(pool->wake);
+		SDL_UnlockMutex(pool->lock);
+
+		for (size_t i = 1; i <= pool->started; i++)
+			SDL_WaitThread(pool->workers[i].thread, NULL);
+	}
+
+	if (pool->lock != NULL)
+		SDL_DestroyMutex(pool->lock);
+
+	if (pool->wake != NULL)
+		SDL_DestroyCond(pool->wake);
+
+	if (pool->done != NULL)
+		SDL_DestroyCond(pool->done);
+
+	free(pool->workers);
+
+	pool->workers = NULL;
+	pool->lock = NULL;
+	pool->wake = NULL;
+	pool->done = NULL;
+	pool->threads = 1;
+	pool->started = 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <SDL_thread.h>
+#include <SDL_mutex.h>
+#include <SG_types.h>
+#include "fixed.h"
+#include "world.h"
+
+/*
+	Every entity of a world as a structure of arrays.
+	Physics_step runs each pass over all entities at once, the velocity
+	passes only touch contiguous floats so the compiler can vectorize
+	them. max_velocity and decceleration are per entity copies of
+	DATA_ENTITIES, so no pass has to look up the type.
+	prev_x and prev_y hold the positions before the last step, for
+	drawing between steps.
+	ticks is how many steps of time an entity covers in the current
+	step. 0 keeps it still: next to chunks that are not streamed in,
+	asleep, or far off the view between two of its ticks. Entities
+	more than lod_distance px off the view tick once every lod_interval
+	steps, for lod_interval steps at once (1 = every step).
+	An entity falls asleep when it rests on the ground without walking
+	velocity, then costs one flag test per step until Physics_wake.
+
+	A step has two phases, integrate (velocities, over contiguous index
+	slices) and resolve (tile collision, over slices of a region order,
+	see SpatialHash). A PhysicsPool runs each phase on all its threads,
+	the caller included, with a barrier in between. Entities only read
+	their own state and the world, so the result is bit-identical to a
+	step on one thread.
+
+	With a rate above 0 the physics run in fixed point (see fixed.h),
+	every step is then 1 / rate seconds long and the fixed_ arrays hold
+	the state. The float arrays are copies of it after each step, for
+	drawing and the SpatialHash. The result is the same on every build.
+	fixed_decceleration is per step.
+*/
+
+typedef struct Physics {
+	bool invalid;
+	size_t len;
+	uint32_t *id;
+	float *x;
+	float *y;
+	float *w;
+	float *h;
+	float *prev_x;
+	float *prev_y;
+	float *velocity_x;
+	float *velocity_y;
+	float *max_velocity;
+	float *decceleration;
+	uint8_t *grounded;
+	uint8_t *ticks;
+	uint8_t *asleep;
+
+	float lod_distance;
+	uint8_t lod_interval;
+	uint32_t step;
+
+	int32_t rate;
+	Fixed *fixed_x;
+	Fixed *fixed_y;
+	Fixed *fixed_w;
+	Fixed *fixed_h;
+	Fixed *fixed_velocity_x;
+	Fixed *fixed_velocity_y;
+	Fixed *fixed_max_velocity;
+	Fixed *fixed_decceleration;
+} Physics;
+
+typedef enum PhysicsPhase {
+	PP_INTEGRATE,
+	PP_RESOLVE,
+} PhysicsPhase;
+
+typedef struct PhysicsPool PhysicsPool;
+
+/*
+	Fewer entities than this per thread are not worth waking a worker
+	for. bench/sim_bench measured about 0.1 us per entity and step and
+	10 to 35 us to wake the pool, so 1024 keeps waking below a third of
+	the work it shares out. That was on one core, the scaling over more
+	threads is not measured yet, which is why sim_threads defaults to 1.
+*/
+#define PHYSICS_MIN_PER_THREAD 1024
+
+typedef struct PhysicsWorker {
+	PhysicsPool *pool;
+	SDL_Thread *thread;
+	size_t part;
+	uint32_t generation;
+} PhysicsWorker;
+
+/*
+	Worker threads start with the first step that needs them.
+	A step with fewer than min_part entities per thread runs on fewer
+	threads, PhysicsPool_new sets it to PHYSICS_MIN_PER_THREAD.
+*/
+struct PhysicsPool {
+	bool invalid;
+	size_t threads;
+	size_t min_part;
+	size_t started;
+	PhysicsWorker *workers;
+	SDL_mutex *lock;
+	SDL_cond *wake;
+	SDL_cond *done;
+	uint32_t generation;
+	size_t pending;
+	size_t parts;
+	bool quit;
+
+	PhysicsPhase phase;
+	Physics *phys;
+	const World *world;
+	const SG_FRect *view;
+	const uint32_t *order;
+	float dt;
+};
+
+Physics Physics_new(const World * world, const int32_t rate);
+
+bool Physics_fixed_fits(const World * world);
+
+void Physics_accelerate(Physics * phys, const size_t i, const float x,
+			const float y, const float dt);
+
+void Physics_impulse(Physics * phys, const size_t i, const float x,
+		     const float y);
+
+void Physics_step(Physics * phys, const World * world, const float dt,
+		  const SG_FRect * view, const uint32_t * order,
+		  PhysicsPool * pool);
+
+/* entity i simulates again from the next step on */
+static inline void Physics_wake(Physics * phys, const size_t i)
+{
+	phys->asleep[i] = 0;
+}
+
+void Physics_clear(Physics * phys);
+
+PhysicsPool PhysicsPool_new(const size_t threads);
+
+void PhysicsPool_clear(PhysicsPool * pool);
+
+#endif				// PHYSICS_H
@@ -0,0 +1,443 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include "block.h"
+#include "query.h"
+
+// merged rects a chunk may have before a ray walks its tiles instead
+#define QUERY_RECTS_MAX 24
+
+/* tile of coordinate a, may lie outside the world */
+static int64_t tile_of(const float a)
+{
+	return (int64_t) floorf(a / BLOCK_SIZE);
+}
+
+/* last tile of a span ending at b, which is exclusive */
+static int64_t tile_before(const float b)
+{
+	return (int64_t) ceilf(b / BLOCK_SIZE) - 1;
+}
+
+/*
+	First solid tile of columns x1 to x2 in rows y1 to y2, clipped to
+	the world, false if there is none.
+*/
+static bool area_solid(const World * world, int64_t x1, int64_t x2,
+		       int64_t y1, int64_t y2, size_t *tile_x, size_t *tile_y)
+{
+	uint64_t bits;
+
+	if (x1 < 0)
+		x1 = 0;
+
+	if (y1 < 0)
+		y1 = 0;
+
+	if (x2 > (int64_t) world->width - 1)
+		x2 = (int64_t) world->width - 1;
+
+	if (y2 > (int64_t) world->height - 1)
+		y2 = (int64_t) world->height - 1;
+
+	if (x1 > x2 || y1 > y2)
+		return false;
+
+	for (size_t y = y1; y <= (size_t) y2; y++)
+		for (size_t w = (size_t) x1 >> WORLD_SOLID_SHIFT;
+		     w <= (size_t) x2 >> WORLD_SOLID_SHIFT; w++) {
+			bits = World_solid_word(world, w, y, x1, x2);
+
+			if (bits != 0) {
+				*tile_x = (w << WORLD_SOLID_SHIFT) +
+				    World_solid_first(bits);
+				*tile_y = y;
+				return true;
+			}
+		}
+
+	return false;
+}
+
+/* a grid walk (DDA) of a ray through cells of size, from border to border */
+typedef struct GridWalk {
+	int64_t x;
+	int64_t y;
+	int64_t step_x;
+	int64_t step_y;
+	float next_x;
+	float next_y;
+	float delta_x;
+	float delta_y;
+	float t;
+	float normal_x;
+	float normal_y;
+} GridWalk;
+
+/* cell of coordinate a, on a border the one a ray moving by d enters */
+static int64_t cell_of(const float a, const float d, const float size)
+{
+	return d < 0.0f ? (int64_t) ceilf(a / size) - 1 :
+	    (int64_t) floorf(a / size);
+}
+
+/* walk of the ray x, y by dx, dy, in cell cx, cy at time t */
+static GridWalk GridWalk_new(const int64_t cx, const int64_t cy,
+			     const float x, const float y, const float dx,
+			     const float dy, const float size, const float t)
+{
+	GridWalk walk = {
+		.x = cx,
+		.y = cy,
+		.step_x = dx > 0.0f ? 1 : -1,
+		.step_y = dy > 0.0f ? 1 : -1,
+		.delta_x = dx != 0.0f ? size / fabsf(dx) : INFINITY,
+		.delta_y = dy != 0.0f ? size / fabsf(dy) : INFINITY,
+		.t = t,
+	};
+
+	// time of the next column and row border
+	walk.next_x = dx > 0.0f ? ((cx + 1) * size - x) / dx :
+	    dx < 0.0f ? (cx * size - x) / dx : INFINITY;
+	walk.next_y = dy > 0.0f ? ((cy + 1) * size - y) / dy :
+	    dy < 0.0f ? (cy * size - y) / dy : INFINITY;
+
+	return walk;
+}
+
+/* through a corner the walk steps on both axes, it only grazes the sides */
+static void GridWalk_step(GridWalk * walk)
+{
+	if (walk->next_x < walk->next_y) {
+		walk->t = walk->next_x;
+		walk->next_x += walk->delta_x;
+		walk->x += walk->step_x;
+		walk->normal_x = -walk->step_x;
+		walk->normal_y = 0.0f;
+		return;
+	}
+
+	if (walk->next_x == walk->next_y) {
+		walk->next_x += walk->delta_x;
+		walk->x += walk->step_x;
+	}
+
+	walk->t = walk->next_y;
+	walk->next_y += walk->delta_y;
+	walk->y += walk->step_y;
+	walk->normal_x = 0.0f;
+	walk->normal_y = -walk->step_y;
+}
+
+/* false if the walk is outside w by h cells and moving away */
+static bool GridWalk_ahead(const GridWalk * walk, const float dx,
+			   const float dy, const int64_t w, const int64_t h)
+{
+	return !((walk->x < 0 && dx <= 0.0f) ||
+		 (walk->y < 0 && dy <= 0.0f) ||
+		 (walk->x >= w && dx >= 0.0f) || (walk->y >= h && dy >= 0.0f));
+}
+
+static void hit_at(QueryHit * hit, const float x, const float y,
+		   const float dx, const float dy, const float t)
+{
+	hit->hit = true;
+	hit->time = t;
+	hit->x = x + dx * t;
+	hit->y = y + dy * t;
+}
+
+/* ray against the tiles of chunk cx, cy, from the chunk walk onwards */
+static bool ray_tiles(const World * world, const GridWalk * chunk,
+		      const float x, const float y, const float dx,
+		      const float dy, QueryHit * hit)
+{
+	const int64_t x1 = chunk->x << WORLD_CHUNK_SHIFT;
+	const int64_t y1 = chunk->y << WORLD_CHUNK_SHIFT;
+	const int64_t x2 = x1 + WORLD_CHUNK_MASK;
+	const int64_t y2 = y1 + WORLD_CHUNK_MASK;
+	int64_t tx = cell_of(x + dx * chunk->t, dx, BLOCK_SIZE);
+	int64_t ty = cell_of(y + dy * chunk->t, dy, BLOCK_SIZE);
+	GridWalk walk;
+
+	// rounding may leave the entry point a tile off the chunk
+	tx = tx < x1 ? x1 : tx > x2 ? x2 : tx;
+	ty = ty < y1 ? y1 : ty > y2 ? y2 : ty;
+	walk = GridWalk_new(tx, ty, x, y, dx, dy, BLOCK_SIZE, chunk->t);
+	walk.normal_x = chunk->normal_x;
+	walk.normal_y = chunk->normal_y;
+
+	while (walk.t <= 1.0f && walk.x >= x1 && walk.x <= x2 &&
+	       walk.y >= y1 && walk.y <= y2) {
+		if (walk.x < (int64_t) world->width &&
+		    walk.y < (int64_t) world->height &&
+		    World_is_solid(world, walk.x, walk.y)) {
+			hit_at(hit, x, y, dx, dy, walk.t);
+			hit->normal_x = walk.normal_x;
+			hit->normal_y = walk.normal_y;
+			hit->tile_x = walk.x;
+			hit->tile_y = walk.y;
+			return true;
+		}
+
+		GridWalk_step(&walk);
+	}
+
+	return false;
+}
+
+/*
+	Entry and exit time of the ray on one axis of span a1 to a2, which
+	holds a1 but not a2, like tiles do.
+*/
+static bool ray_slab(const float a, const float d, const float a1,
+		     const float a2, float *t_in, float *t_out)
+{
+	if (d > 0.0f) {
+		*t_in = (a1 - a) / d;
+		*t_out = (a2 - a) / d;
+	} else if (d < 0.0f) {
+		*t_in = (a2 - a) / d;
+		*t_out = (a1 - a) / d;
+	} else {
+		*t_in = -INFINITY;
+		*t_out = INFINITY;
+		return a >= a1 && a < a2;
+	}
+
+	return true;
+}
+
+/* ray against the merged rects of chunk c, the earliest one counts */
+static bool ray_rects(const World * world, const size_t c, const float x,
+		      const float y, const float dx, const float dy,
+		      QueryHit * hit)
+{
+	const size_t x1 = (c % world->chunks_w) << WORLD_CHUNK_SHIFT;
+	const size_t y1 = (c / world->chunks_w) << WORLD_CHUNK_SHIFT;
+	const WorldRect *rect = world->rects[c];
+	const WorldRect *best = NULL;
+	float best_t = INFINITY;
+	bool best_on_x = false;
+	float in_x, out_x, in_y, out_y, t_in;
+	float rx, ry;
+	int64_t tile;
+
+	for (size_t i = 0; i < world->rect_count[c]; i++, rect++) {
+		rx = (x1 + rect->x) * BLOCK_SIZE;
+		ry = (y1 + rect->y) * BLOCK_SIZE;
+
+		if (!ray_slab(x, dx, rx, rx + rect->w * BLOCK_SIZE,
+			      &in_x, &out_x) ||
+		    !ray_slab(y, dy, ry, ry + rect->h * BLOCK_SIZE,
+			      &in_y, &out_y))
+			continue;
+
+		t_in = in_x > in_y ? in_x : in_y;
+
+		if (t_in < 0.0f)
+			t_in = 0.0f;
+
+		if (t_in < out_x && t_in < out_y && t_in <= 1.0f &&
+		    t_in < best_t) {
+			best = rect;
+			best_t = t_in;
+			// a corner counts as a row border, like the walk
+			best_on_x = in_x > in_y;
+		}
+	}
+
+	if (best == NULL)
+		return false;
+
+	hit_at(hit, x, y, dx, dy, best_t);
+
+	if (best_t > 0.0f && best_on_x)
+		hit->normal_x = dx > 0.0f ? -1.0f : 1.0f;
+	else if (best_t > 0.0f)
+		hit->normal_y = dy > 0.0f ? -1.0f : 1.0f;
+	// the tile hit, inside the rect despite rounding
+	tile = cell_of(hit->x, dx, BLOCK_SIZE) - x1;
+	hit->tile_x = x1 + (tile < best->x ? best->x :
+			    tile >= best->x + best->w ?
+			    best->x + best->w - 1 : tile);
+	tile = cell_of(hit->y, dy, BLOCK_SIZE) - y1;
+	hit->tile_y = y1 + (tile < best->y ? best->y :
+			    tile >= best->y + best->h ?
+			    best->y + best->h - 1 : tile);
+
+	return true;
+}
+
+/*
+	Ray from x, y to x + dx, y + dy, stops in the first solid tile.
+	Walks chunks first: empty ones are passed at once, the merged
+	rects of the others are tested as a whole. Chunks with too many
+	rects, or none for lack of memory, are walked tile by tile.
+*/
+QueryHit Query_raycast(const World * world, const float x, const float y,
+		       const float dx, const float dy)
+{
+	const float size = BLOCK_SIZE * WORLD_CHUNK_SIZE;
+	QueryHit hit = {.hit = false,.time = 1.0f,.x = x + dx,.y = y + dy };
+	GridWalk chunk = GridWalk_new(cell_of(x, dx, size),
+				      cell_of(y, dy, size),
+				      x, y, dx, dy, size, 0.0f);
+	size_t c, count;
+
+	while (chunk.t <= 1.0f) {
+		if (chunk.x >= 0 && chunk.y >= 0 &&
+		    chunk.x < (int64_t) world->chunks_w &&
+		    chunk.y < (int64_t) world->chunks_h) {
+			c = chunk.y * world->chunks_w + chunk.x;
+			count = world->rect_count[c];
+
+			if (count > QUERY_RECTS_MAX ?
+			    ray_tiles(world, &chunk, x, y, dx, dy, &hit) :
+			    count > 0 &&
+			    ray_rects(world, c, x, y, dx, dy, &hit))
+				return hit;
+		}
+
+		if (!GridWalk_ahead(&chunk, dx, dy, world->chunks_w,
+				    world->chunks_h))
+			break;
+
+		GridWalk_step(&chunk);
+	}
+
+	return hit;
+}
+
+/*
+	Rect moved by dx, dy at once, stops at the first solid tile.
+	Walks the tile borders its leading edges cross, each crossing
+	checks the one column or row entered, over the span the rect
+	covers at that time. Trailing spans follow the position, leading
+	ones only grow, so a corner entered on both axes at once is seen.
+	A rect touching a tile and moving into it hits at time 0.
+*/
+QueryHit Query_boxcast(const World * world, const SG_FRect * rect,
+		       const float dx, const float dy)
+{
+	QueryHit hit = {
+		.hit = false,
+		.time = 1.0f,
+		.x = rect->x + dx,
+		.y = rect->y + dy,
+	};
+	int64_t x1 = tile_of(rect->x);
+	int64_t x2 = tile_before(rect->x + rect->w);
+	int64_t y1 = tile_of(rect->y);
+	int64_t y2 = tile_before(rect->y + rect->h);
+	float next_x, next_y;
+	float t;
+	int64_t line;
+
+	if (area_solid(world, x1, x2, y1, y2, &hit.tile_x, &hit.tile_y)) {
+		hit.hit = true;
+		hit.time = 0.0f;
+		hit.x = rect->x;
+		hit.y = rect->y;
+		return hit;
+	}
+
+	while (true) {
+		// time the leading edges reach the next border, if in the world
+		next_x = dx > 0.0f && x2 < (int64_t) world->width - 1 ?
+		    ((x2 + 1) * BLOCK_SIZE - rect->x - rect->w) / dx :
+		    dx < 0.0f && x1 > 0 ?
+		    (x1 * BLOCK_SIZE - rect->x) / dx : INFINITY;
+		next_y = dy > 0.0f && y2 < (int64_t) world->height - 1 ?
+		    ((y2 + 1) * BLOCK_SIZE - rect->y - rect->h) / dy :
+		    dy < 0.0f && y1 > 0 ?
+		    (y1 * BLOCK_SIZE - rect->y) / dy : INFINITY;
+
+		t = next_x < next_y ? next_x : next_y;
+
+		if (t > 1.0f)
+			return hit;
+
+		if (dx > 0.0f)
+			x1 = tile_of(rect->x + dx * t);
+		else if (dx < 0.0f)
+			x2 = tile_before(rect->x + rect->w + dx * t);
+
+		if (dy > 0.0f)
+			y1 = tile_of(rect->y + dy * t);
+		else if (dy < 0.0f)
+			y2 = tile_before(rect->y + rect->h + dy * t);
+
+		if (next_x <= next_y) {
+			line = dx > 0.0f ? ++x2 : --x1;
+
+			if (area_solid(world, line, line, y1, y2,
+				       &hit.tile_x, &hit.tile_y)) {
+				hit.x = dx > 0.0f ?
+				    line * BLOCK_SIZE - rect->w :
+				    (line + 1) * BLOCK_SIZE;
+				hit.y = rect->y + dy * t;
+				hit.normal_x = dx > 0.0f ? -1.0f : 1.0f;
+				break;
+			}
+		} else {
+			line = dy > 0.0f ? ++y2 : --y1;
+
+			if (area_solid(world, x1, x2, line, line,
+				       &hit.tile_x, &hit.tile_y)) {
+				hit.x = rect->x + dx * t;
+				hit.y = dy > 0.0f ?
+				    line * BLOCK_SIZE - rect->h :
+				    (line + 1) * BLOCK_SIZE;
+				hit.normal_y = dy > 0.0f ? -1.0f : 1.0f;
+				break;
+			}
+		}
+	}
+
+	hit.hit = true;
+	hit.time = t;
+
+	return hit;
+}
+
+/*
+	True if a solid tile overlaps rect, the first one found goes to
+	tile_x, tile_y unless they are NULL.
+*/
+bool Query_overlap_rect(const World * world, const SG_FRect * rect,
+			size_t *tile_x, size_t *tile_y)
+{
+	size_t x, y;
+
+	if (!area_solid(world, tile_of(rect->x), tile_before(rect->x + rect->w),
+			tile_of(rect->y), tile_before(rect->y + rect->h),
+			&x, &y))
+		return false;
+
+	if (tile_x != NULL)
+		*tile_x = x;
+
+	if (tile_y != NULL)
+		*tile_y = y;
+
+	return true;
+}
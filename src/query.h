@@ -0,0 +1,65 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <SG_types.h>
+#include "world.h"
+
+/*
+	Queries against the solid tiles of a world, for line of sight,
+	ground probes and AI. They walk the grid from the start of the
+	cast and stop at the first solid tile, so the cost grows with the
+	tiles passed, not with the world. Rays walk chunks and test the
+	merged rects of each (see world.h). Tiles outside the world are
+	empty.
+*/
+
+/*
+	Result of a raycast or boxcast.
+	time:		share of the cast travelled before contact, 0 to 1
+	x, y:		contact point of a ray, rect.x and y at contact of a box
+	normal_x, y:	normal of the surface hit, 0 if the cast started
+			inside a solid tile
+	tile_x, y:	the solid tile hit
+*/
+typedef struct QueryHit {
+	bool hit;
+	float time;
+	float x;
+	float y;
+	float normal_x;
+	float normal_y;
+	size_t tile_x;
+	size_t tile_y;
+} QueryHit;
+
+QueryHit Query_raycast(const World * world, const float x, const float y,
+		       const float dx, const float dy);
+
+QueryHit Query_boxcast(const World * world, const SG_FRect * rect,
+		       const float dx, const float dy);
+
+bool Query_overlap_rect(const World * world, const SG_FRect * rect,
+			size_t *tile_x, size_t *tile_y);
+
+#endif				// QUERY_H
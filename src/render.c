@@ -0,0 +1,228 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#include <stdlib.h>
+#include "block.h"
+#include "render.h"
+
+/* room for len more quads, indices of new quads get written once */
+static bool TileBatch_reserve(TileBatch * batch, const size_t len)
+{
+	size_t cap = batch->cap > 0 ? batch->cap : 256;
+	SDL_Vertex *vertices;
+	int *indices;
+
+	if (batch->len + len <= batch->cap)
+		return true;
+
+	while (cap < batch->len + len)
+		cap *= 2;
+
+	vertices = realloc(batch->vertices, cap * 4 * sizeof(SDL_Vertex));
+
+	if (vertices == NULL)
+		return false;
+
+	batch->vertices = vertices;
+	indices = realloc(batch->indices, cap * 6 * sizeof(int));
+
+	if (indices == NULL)
+		return false;
+
+	batch->indices = indices;
+
+	// two triangles per quad: top left, top right, bottom left, right
+	for (size_t i = batch->cap; i < cap; i++) {
+		indices[i * 6] = i * 4;
+		indices[i * 6 + 1] = i * 4 + 1;
+		indices[i * 6 + 2] = i * 4 + 2;
+		indices[i * 6 + 3] = i * 4 + 2;
+		indices[i * 6 + 4] = i * 4 + 1;
+		indices[i * 6 + 5] = i * 4 + 3;
+	}
+
+	batch->cap = cap;
+
+	return true;
+}
+
+TileBatch TileBatch_new(const Atlas * atlas, const size_t cap)
+{
+	TileBatch batch = {
+		.invalid = false,
+		.copies = false,
+		.atlas = atlas,
+		.vertices = NULL,
+		.indices = NULL,
+		.len = 0,
+		.cap = 0,
+		.tiles = 0,
+		.culled = 0,
+	};
+
+	if (!TileBatch_reserve(&batch, cap)) {
+		TileBatch_clear(&batch);
+		batch.invalid = true;
+	}
+
+	return batch;
+}
+
+static void TileBatch_add(TileBatch * batch, const SDL_Rect * src,
+			  const float x, const float y)
+{
+	SDL_Vertex *v = &batch->vertices[batch->len * 4];
+	const float u1 = (float)src->x / batch->atlas->w;
+	const float v1 = (float)src->y / batch->atlas->h;
+	const float u2 = (float)(src->x + src->w) / batch->atlas->w;
+	const float v2 = (float)(src->y + src->h) / batch->atlas->h;
+
+	for (size_t i = 0; i < 4; i++) {
+		v[i].position.x = i & 1 ? x + BLOCK_SIZE : x;
+		v[i].position.y = i & 2 ? y + BLOCK_SIZE : y;
+		v[i].tex_coord.x = i & 1 ? u2 : u1;
+		v[i].tex_coord.y = i & 2 ? v2 : v1;
+		v[i].color.r = 255;
+		v[i].color.g = 255;
+		v[i].color.b = 255;
+		v[i].color.a = 255;
+	}
+
+	batch->len++;
+}
+
+/*
+	Adds the walls and, or blocks of tiles x1 to x2, y1 to y2 (both
+	exclusive), tile x1, y1 at x, y. B_NONE adds nothing, neither does a
+	wall behind an opaque block when blocks are drawn. False if the batch
+	could not grow, nothing is added then.
+*/
+bool TileBatch_add_tiles(TileBatch * batch, const World * world,
+			 const size_t x1, const size_t y1, const size_t x2,
+			 const size_t y2, const int x, const int y,
+			 const bool walls, const bool blocks)
+{
+	const SDL_Rect *src;
+	float px, py;
+
+	if (x1 >= x2 || y1 >= y2)
+		return true;
+
+	if (!TileBatch_reserve(batch, (x2 - x1) * (y2 - y1) *
+			       ((walls ? 1 : 0) + (blocks ? 1 : 0))))
+		return false;
+
+	batch->tiles += (x2 - x1) * (y2 - y1);
+
+	for (size_t ty = y1; ty < y2; ty++) {
+		py = y + (float)(ty - y1) * BLOCK_SIZE;
+
+		for (size_t tx = x1; tx < x2; tx++) {
+			px = x + (float)(tx - x1) * BLOCK_SIZE;
+
+			// tiles do not overlap, no need for a pass per layer
+			if (walls && blocks && World_is_covered(world, tx, ty))
+				batch->culled++;
+			else if (walls) {
+				src = Atlas_tile(batch->atlas, L_WALL,
+						 World_get_block(world, tx, ty,
+								 L_WALL));
+
+				if (src->w > 0)
+					TileBatch_add(batch, src, px, py);
+			}
+
+			if (blocks) {
+				src = Atlas_tile(batch->atlas, L_BLOCK,
+						 World_get_block(world, tx, ty,
+								 L_BLOCK));
+
+				if (src->w > 0)
+					TileBatch_add(batch, src, px, py);
+			}
+		}
+	}
+
+	return true;
+}
+
+/* the per tile path, one copy for every quad */
+static void TileBatch_copy(TileBatch * batch, SDL_Renderer * renderer,
+			   RenderStats * stats)
+{
+	const SDL_Vertex *v;
+	SDL_Rect src, dst;
+
+	for (size_t i = 0; i < batch->len; i++) {
+		v = &batch->vertices[i * 4];
+		src.x = v[0].tex_coord.x * batch->atlas->w + 0.5f;
+		src.y = v[0].tex_coord.y * batch->atlas->h + 0.5f;
+		src.w = v[3].tex_coord.x * batch->atlas->w + 0.5f - src.x;
+		src.h = v[3].tex_coord.y * batch->atlas->h + 0.5f - src.y;
+		dst.x = v[0].position.x;
+		dst.y = v[0].position.y;
+		dst.w = BLOCK_SIZE;
+		dst.h = BLOCK_SIZE;
+
+		Render_copy(renderer, stats, batch->atlas->texture, &src,
+			    &dst);
+	}
+}
+
+/* one call for every quad, copies if set or the renderer lacks geometry */
+void TileBatch_draw(TileBatch * batch, SDL_Renderer * renderer,
+		    RenderStats * stats)
+{
+	stats->tiles += batch->tiles;
+	stats->quads += batch->len;
+	stats->culled += batch->culled;
+	batch->tiles = 0;
+	batch->culled = 0;
+
+	if (batch->len == 0)
+		return;
+
+	if (batch->copies) {
+		TileBatch_copy(batch, renderer, stats);
+		batch->len = 0;
+		return;
+	}
+
+	RenderStats_call(stats, batch->atlas->texture);
+
+	if (SDL_RenderGeometry(renderer, batch->atlas->texture,
+			       batch->vertices, batch->len * 4,
+			       batch->indices, batch->len * 6) != 0)
+		TileBatch_copy(batch, renderer, stats);
+
+	batch->len = 0;
+}
+
+void TileBatch_clear(TileBatch * batch)
+{
+	free(batch->vertices);
+	free(batch->indices);
+
+	batch->vertices = NULL;
+	batch->indices = NULL;
+	batch->len = 0;
+	batch->cap = 0;
+	batch->tiles = 0;
+	batch->culled = 0;
+}
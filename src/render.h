@@ -0,0 +1,108 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <SDL_render.h>
+#include "atlas.h"
+#include "world.h"
+
+/*
+	Draw calls of one frame. A switch is a call with another texture
+	than the call before, which keeps the renderer from batching.
+	Overdraw is quads drawn per tile batched, walls hidden behind
+	opaque blocks are culled instead (see World_is_covered).
+*/
+typedef struct RenderStats {
+	SDL_Texture *bound;
+	uint32_t calls;
+	uint32_t switches;
+	uint32_t tiles;
+	uint32_t quads;
+	uint32_t culled;
+} RenderStats;
+
+/*
+	Tiles as quads of one vertex buffer, sent with one SDL_RenderGeometry
+	call instead of a copy per tile. Every quad samples the atlas, the
+	index buffer is the same for every batch and only grows.
+	With copies set, or when the renderer rejects geometry, each quad
+	is drawn with its own copy as before batching. Which is faster on
+	a given renderer is not measured yet, bench/render_bench compares
+	both (gfx_tile_batch picks one).
+*/
+typedef struct TileBatch {
+	bool invalid;
+	bool copies;
+	const Atlas *atlas;
+	SDL_Vertex *vertices;
+	int *indices;
+	size_t len;		/* quads */
+	size_t cap;
+	size_t tiles;		/* added since the last draw, for stats */
+	size_t culled;
+} TileBatch;
+
+static inline void RenderStats_frame(RenderStats * stats)
+{
+	stats->bound = NULL;
+	stats->calls = 0;
+	stats->switches = 0;
+	stats->tiles = 0;
+	stats->quads = 0;
+	stats->culled = 0;
+}
+
+static inline void RenderStats_call(RenderStats * stats,
+				    SDL_Texture * texture)
+{
+	if (texture != stats->bound) {
+		stats->bound = texture;
+		stats->switches++;
+	}
+
+	stats->calls++;
+}
+
+static inline int Render_copy(SDL_Renderer * renderer, RenderStats * stats,
+			      SDL_Texture * texture, const SDL_Rect * src,
+			      const SDL_Rect * dst)
+{
+	RenderStats_call(stats, texture);
+
+	return SDL_RenderCopy(renderer, texture, src, dst);
+}
+
+TileBatch TileBatch_new(const Atlas * atlas, const size_t cap);
+
+bool TileBatch_add_tiles(TileBatch * batch, const World * world,
+			 const size_t x1, const size_t y1, const size_t x2,
+			 const size_t y2, const int x, const int y,
+			 const bool walls, const bool blocks);
+
+void TileBatch_draw(TileBatch * batch, SDL_Renderer * renderer,
+		    RenderStats * stats);
+
+void TileBatch_clear(TileBatch * batch);
+
+#endif				// RENDER_H
@@ -0,0 +1,140 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#include <SM_log.h>
+#include "path.h"
+#include "worldfile.h"
+#include "save.h"
+
+static int WorldSave_worker(void *data)
+{
+	WorldSave *save = (WorldSave *) data;
+
+	save->result = WorldFile_write_dirty(&save->snapshot, save->path.str,
+					     save->compress, &save->progress);
+	SDL_AtomicSet(&save->finished, 1);
+
+	return 0;
+}
+
+static void WorldSave_begin(WorldSave * save, World * world)
+{
+	save->pending = false;
+	save->snapshot = World_snapshot(world);
+
+	if (save->snapshot.invalid) {
+		SM_log_err("World snapshot could not be taken.");
+		save->state = SS_FAILED;
+		return;
+	}
+
+	SDL_AtomicSet(&save->progress, 0);
+	SDL_AtomicSet(&save->finished, 0);
+	save->state = SS_RUNNING;
+	save->thread = SDL_CreateThread(WorldSave_worker, "world_save", save);
+
+	if (save->thread == NULL) {
+		SM_log_err("World save thread could not be started.");
+		World_release_snapshot(world, &save->snapshot, false);
+		save->state = SS_FAILED;
+	}
+}
+
+WorldSave WorldSave_new(void)
+{
+	WorldSave save = {
+		.path = SM_String_new(8),
+		.compress = false,
+		.pending = false,
+		.state = SS_IDLE,
+		.thread = NULL,
+		.result = false,
+	};
+
+	SDL_AtomicSet(&save.progress, 0);
+	SDL_AtomicSet(&save.finished, 0);
+
+	return save;
+}
+
+void WorldSave_start(WorldSave * save, World * world, const char *world_name,
+		     const bool compress)
+{
+	// merge into the next save
+	if (save->state == SS_RUNNING) {
+		save->pending = true;
+		return;
+	}
+
+	save->compress = compress;
+
+	SM_String_copy_cstr(&save->path, "");
+
+	if (get_world_filepath(&save->path, world_name) != 0) {
+		save->state = SS_FAILED;
+		return;
+	}
+
+	WorldSave_begin(save, world);
+}
+
+static void WorldSave_finish(WorldSave * save, World * world)
+{
+	SDL_WaitThread(save->thread, NULL);
+	save->thread = NULL;
+
+	World_release_snapshot(world, &save->snapshot, save->result);
+
+	if (save->result) {
+		save->state = SS_DONE;
+	} else {
+		SM_log_err("World could not be saved.");
+		save->state = SS_FAILED;
+	}
+
+	if (save->pending)
+		WorldSave_begin(save, world);
+}
+
+/* returns true when a save finished since the last call */
+bool WorldSave_update(WorldSave * save, World * world)
+{
+	if (save->state != SS_RUNNING || SDL_AtomicGet(&save->finished) == 0)
+		return false;
+
+	WorldSave_finish(save, world);
+
+	return true;
+}
+
+float WorldSave_progress(WorldSave * save)
+{
+	return SDL_AtomicGet(&save->progress) / 1000.0f;
+}
+
+void WorldSave_wait(WorldSave * save, World * world)
+{
+	while (save->state == SS_RUNNING)
+		WorldSave_finish(save, world);
+}
+
+void WorldSave_clear(WorldSave * save)
+{
+	SM_String_clear(&save->path);
+}
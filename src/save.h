@@ -0,0 +1,68 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#ifndef SAVE_H
+#define SAVE_H
+
+#include <stdbool.h>
+#include <SDL_thread.h>
+#include <SDL_atomic.h>
+#include <SM_string.h>
+#include "world.h"
+
+/*
+	Saves a world on a worker thread.
+	The world is snapshotted first, chunks edited during the save get
+	copied (see World_thaw_chunk), so the editor never waits for disk.
+	Saves requested while one runs are merged into a single follow-up.
+*/
+
+typedef enum SaveState {
+	SS_IDLE,
+	SS_RUNNING,
+	SS_DONE,
+	SS_FAILED,
+} SaveState;
+
+typedef struct WorldSave {
+	SM_String path;
+	bool compress;
+	bool pending;
+	SaveState state;
+	World snapshot;
+	SDL_Thread *thread;
+	SDL_atomic_t progress;
+	SDL_atomic_t finished;
+	bool result;
+} WorldSave;
+
+WorldSave WorldSave_new(void);
+
+void WorldSave_start(WorldSave * save, World * world, const char *world_name,
+		     const bool compress);
+
+bool WorldSave_update(WorldSave * save, World * world);
+
+float WorldSave_progress(WorldSave * save);
+
+void WorldSave_wait(WorldSave * save, World * world);
+
+void WorldSave_clear(WorldSave * save);
+
+#endif				// SAVE_H
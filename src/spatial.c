@@ -0,0 +1,334 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "spatial.h"
+
+#define SPATIAL_CELL_SIZE (BLOCK_SIZE * WORLD_CHUNK_SIZE)
+
+// room for every entity overlapping a corner of 4 cells, grows if needed
+#define SPATIAL_ITEMS_PER_ENTITY 4
+
+SpatialHash SpatialHash_new(const World * world, const size_t len)
+{
+	SpatialHash hash = {
+		.invalid = false,
+		.cells_w = world->chunks_w,
+		.cells_h = world->chunks_h,
+		.items_cap = len * SPATIAL_ITEMS_PER_ENTITY,
+	};
+	const size_t cells = hash.cells_w * hash.cells_h;
+
+	hash.cell_start = calloc(cells + 1, sizeof(uint32_t));
+	hash.cell_fill = calloc(cells, sizeof(uint32_t));
+	hash.items = calloc(hash.items_cap, sizeof(uint32_t));
+	hash.type_items = calloc(len, sizeof(uint32_t));
+	hash.order = calloc(len, sizeof(uint32_t));
+	hash.stamp = calloc(len, sizeof(uint32_t));
+	hash.found = calloc(len, sizeof(uint32_t));
+
+	if (hash.cell_start == NULL || hash.cell_fill == NULL ||
+	    (len > 0 && (hash.items == NULL || hash.type_items == NULL ||
+			 hash.order == NULL || hash.stamp == NULL ||
+			 hash.found == NULL))) {
+		SpatialHash_clear(&hash);
+		hash.invalid = true;
+	}
+
+	return hash;
+}
+
+static size_t cell_clamp(const float pos, const size_t cells)
+{
+	const float cell = pos / SPATIAL_CELL_SIZE;
+
+	if (!(cell > 0.0f))
+		return 0;
+
+	if (cell >= (float)cells)
+		return cells - 1;
+
+	return (size_t) cell;
+}
+
+/* cells a rect overlaps, rects outside of the world use the border */
+static void cell_range(const SpatialHash * hash, const float x,
+		       const float y, const float w, const float h,
+		       size_t range[4])
+{
+	range[0] = cell_clamp(x, hash->cells_w);
+	range[1] = cell_clamp(y, hash->cells_h);
+	range[2] = cell_clamp(x + w, hash->cells_w);
+	range[3] = cell_clamp(y + h, hash->cells_h);
+}
+
+/* the cell an entity belongs to, the one of its top left corner */
+static size_t owner_cell(const SpatialHash * hash, const Physics * phys,
+			 const size_t i)
+{
+	return cell_clamp(phys->y[i], hash->cells_h) * hash->cells_w +
+	    cell_clamp(phys->x[i], hash->cells_w);
+}
+
+static bool overlap(const Physics * phys, const size_t i, const float x,
+		    const float y, const float w, const float h)
+{
+	return phys->x[i] < x + w && x < phys->x[i] + phys->w[i] &&
+	    phys->y[i] < y + h && y < phys->y[i] + phys->h[i];
+}
+
+bool SpatialHash_build(SpatialHash * hash, const Physics * phys)
+{
+	const size_t cells = hash->cells_w * hash->cells_h;
+	uint32_t type_fill[E_LAST + 1] = { 0 };
+	size_t range[4];
+	size_t total = 0;
+	uint32_t *items;
+
+	// count entities per cell and type
+	memset(hash->cell_start, 0, (cells + 1) * sizeof(uint32_t));
+	memset(hash->type_start, 0, sizeof(hash->type_start));
+
+	for (size_t i = 0; i < phys->len; i++) {
+		cell_range(hash, phys->x[i], phys->y[i], phys->w[i],
+			   phys->h[i], range);
+
+		for (size_t cy = range[1]; cy <= range[3]; cy++)
+			for (size_t cx = range[0]; cx <= range[2]; cx++)
+				hash->cell_start[cy * hash->cells_w + cx + 1]++;
+
+		total += (range[2] - range[0] + 1) * (range[3] - range[1] + 1);
+		hash->type_start[phys->id[i] + 1]++;
+	}
+
+	if (total > hash->items_cap) {
+		items = realloc(hash->items, total * sizeof(uint32_t));
+
+		if (items == NULL)
+			return false;
+
+		hash->items = items;
+		hash->items_cap = total;
+	}
+	// counts to offsets
+	for (size_t c = 0; c < cells; c++)
+		hash->cell_start[c + 1] += hash->cell_start[c];
+
+	for (size_t t = 0; t <= E_LAST; t++)
+		hash->type_start[t + 1] += hash->type_start[t];
+
+	// scatter
+	memcpy(hash->cell_fill, hash->cell_start, cells * sizeof(uint32_t));
+
+	for (size_t i = 0; i < phys->len; i++) {
+		cell_range(hash, phys->x[i], phys->y[i], phys->w[i],
+			   phys->h[i], range);
+
+		for (size_t cy = range[1]; cy <= range[3]; cy++)
+			for (size_t cx = range[0]; cx <= range[2]; cx++)
+				hash->items[hash->cell_fill
+					    [cy * hash->cells_w + cx]++] = i;
+	}
+
+	// walking the cells in order gives the region order
+	total = 0;
+
+	for (size_t cell = 0; cell < cells; cell++)
+		for (uint32_t j = hash->cell_start[cell];
+		     j < hash->cell_start[cell + 1]; j++)
+			if (owner_cell(hash, phys, hash->items[j]) == cell)
+				hash->order[total++] = hash->items[j];
+
+	// entities stay in index order within their type
+	for (size_t i = 0; i < phys->len; i++)
+		hash->type_items[hash->type_start[phys->id[i]] +
+				 type_fill[phys->id[i]]++] = i;
+
+	return true;
+}
+
+/* entities overlapping rect, written to found, returns their count */
+size_t SpatialHash_query(SpatialHash * hash, const Physics * phys,
+			 const SG_FRect * rect)
+{
+	size_t range[4];
+	size_t count = 0;
+	uint32_t i;
+
+	// a new stamp marks entities seen in this query, reset on wrap
+	if (++hash->stamp_now == 0) {
+		memset(hash->stamp, 0, phys->len * sizeof(uint32_t));
+		hash->stamp_now = 1;
+	}
+
+	cell_range(hash, rect->x, rect->y, rect->w, rect->h, range);
+
+	for (size_t cy = range[1]; cy <= range[3]; cy++) {
+		for (size_t cx = range[0]; cx <= range[2]; cx++) {
+			const size_t cell = cy * hash->cells_w + cx;
+
+			for (uint32_t j = hash->cell_start[cell];
+			     j < hash->cell_start[cell + 1]; j++) {
+				i = hash->items[j];
+
+				if (hash->stamp[i] == hash->stamp_now)
+					continue;
+
+				hash->stamp[i] = hash->stamp_now;
+
+				if (overlap(phys, i, rect->x, rect->y,
+					    rect->w, rect->h))
+					hash->found[count++] = i;
+			}
+		}
+	}
+
+	return count;
+}
+
+/*
+	Overlapping entity pairs, written to pairs.
+	Two entities can share several cells, a pair is only reported by
+	the cell holding the top left corner of their intersection.
+*/
+bool SpatialHash_pairs(SpatialHash * hash, const Physics * phys)
+{
+	EntityPair *pairs;
+	size_t cap;
+	uint32_t a, b;
+	float x, y;
+
+	hash->pair_len = 0;
+
+	for (size_t cell = 0; cell < hash->cells_w * hash->cells_h; cell++) {
+		for (uint32_t j = hash->cell_start[cell];
+		     j < hash->cell_start[cell + 1]; j++) {
+			a = hash->items[j];
+
+			for (uint32_t k = j + 1;
+			     k < hash->cell_start[cell + 1]; k++) {
+				b = hash->items[k];
+
+				if (!overlap(phys, b, phys->x[a], phys->y[a],
+					     phys->w[a], phys->h[a]))
+					continue;
+
+				x = phys->x[a] > phys->x[b] ?
+				    phys->x[a] : phys->x[b];
+				y = phys->y[a] > phys->y[b] ?
+				    phys->y[a] : phys->y[b];
+
+				if (cell_clamp(y, hash->cells_h) *
+				    hash->cells_w +
+				    cell_clamp(x, hash->cells_w) != cell)
+					continue;
+
+				if (hash->pair_len == hash->pair_cap) {
+					cap = hash->pair_cap * 2 + 64;
+					pairs = realloc(hash->pairs,
+							cap *
+							sizeof(EntityPair));
+
+					if (pairs == NULL)
+						return false;
+
+					hash->pairs = pairs;
+					hash->pair_cap = cap;
+				}
+
+				hash->pairs[hash->pair_len].a = a;
+				hash->pairs[hash->pair_len].b = b;
+				hash->pair_len++;
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+	Wakes sleeping entities touching one that moved in the last step.
+	Only cells holding a sleeper pair up their entities, so a world at
+	rest or without sleepers costs a pass over the items.
+*/
+void SpatialHash_wake(const SpatialHash * hash, Physics * phys)
+{
+	const size_t cells = hash->cells_w * hash->cells_h;
+	const uint32_t *items;
+	size_t len;
+	size_t asleep;
+	uint32_t a, b;
+
+	for (size_t c = 0; c < cells; c++) {
+		items = &hash->items[hash->cell_start[c]];
+		len = hash->cell_start[c + 1] - hash->cell_start[c];
+		asleep = 0;
+
+		for (size_t i = 0; i < len; i++)
+			asleep += phys->asleep[items[i]];
+
+		if (asleep == 0)
+			continue;
+
+		for (size_t i = 0; i < len; i++) {
+			a = items[i];
+
+			if (phys->x[a] == phys->prev_x[a] &&
+			    phys->y[a] == phys->prev_y[a])
+				continue;
+
+			// grown by a pixel, so touching counts
+			for (size_t j = 0; j < len; j++) {
+				b = items[j];
+
+				if (b != a && phys->asleep[b] &&
+				    overlap(phys, b, phys->x[a] - 1.0f,
+					    phys->y[a] - 1.0f,
+					    phys->w[a] + 2.0f,
+					    phys->h[a] + 2.0f))
+					Physics_wake(phys, b);
+			}
+		}
+	}
+}
+
+void SpatialHash_clear(SpatialHash * hash)
+{
+	free(hash->cell_start);
+	free(hash->cell_fill);
+	free(hash->items);
+	free(hash->type_items);
+	free(hash->order);
+	free(hash->stamp);
+	free(hash->found);
+	free(hash->pairs);
+
+	hash->cell_start = NULL;
+	hash->cell_fill = NULL;
+	hash->items = NULL;
+	hash->type_items = NULL;
+	hash->order = NULL;
+	hash->stamp = NULL;
+	hash->found = NULL;
+	hash->pairs = NULL;
+	hash->items_cap = 0;
+	hash->pair_len = 0;
+	hash->pair_cap = 0;
+}
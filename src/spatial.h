@@ -0,0 +1,91 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <SG_types.h>
+#include "entity.h"
+#include "physics.h"
+#include "world.h"
+
+/*
+	Broadphase for entities, a uniform grid with one cell per chunk.
+	SpatialHash_build sorts the entities of a Physics into the cells
+	their rect overlaps (counting sort, no per cell allocations) and
+	into one bucket per type.
+	order lists every entity once, by the cell of its top left corner,
+	so a slice of it is one region of the world (see Physics_step).
+	Region queries and pairs only look at the cells involved, found
+	and pairs stay valid until the next call.
+*/
+
+typedef struct EntityPair {
+	uint32_t a;
+	uint32_t b;
+} EntityPair;
+
+typedef struct SpatialHash {
+	bool invalid;
+	size_t cells_w;
+	size_t cells_h;
+	uint32_t *cell_start;
+	uint32_t *cell_fill;
+	uint32_t *items;
+	size_t items_cap;
+
+	uint32_t type_start[E_LAST + 2];
+	uint32_t *type_items;
+	uint32_t *order;
+
+	uint32_t *stamp;
+	uint32_t stamp_now;
+	uint32_t *found;
+
+	EntityPair *pairs;
+	size_t pair_len;
+	size_t pair_cap;
+} SpatialHash;
+
+SpatialHash SpatialHash_new(const World * world, const size_t len);
+
+bool SpatialHash_build(SpatialHash * hash, const Physics * phys);
+
+size_t SpatialHash_query(SpatialHash * hash, const Physics * phys,
+			 const SG_FRect * rect);
+
+bool SpatialHash_pairs(SpatialHash * hash, const Physics * phys);
+
+void SpatialHash_wake(const SpatialHash * hash, Physics * phys);
+
+/* entities of one type, in entity order */
+static inline const uint32_t *SpatialHash_type(const SpatialHash * hash,
+					       const Entity type,
+					       size_t *count)
+{
+	*count = hash->type_start[type + 1] - hash->type_start[type];
+
+	return &hash->type_items[hash->type_start[type]];
+}
+
+void SpatialHash_clear(SpatialHash * hash);
+
+#endif				// SPATIAL_H
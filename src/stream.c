@@ -0,0 +1,472 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SM_log.h>
+#include <SDL_thread.h>
+#include <SDL_mutex.h>
+#include "block.h"
+#include "stream.h"
+
+/* chunk bounds, inclusive */
+typedef struct ChunkArea {
+	size_t x1;
+	size_t y1;
+	size_t x2;
+	size_t y2;
+} ChunkArea;
+
+static const uint8_t EMPTY_CHUNK[WORLD_CHUNK_BYTES] = { B_NONE };
+
+static int WorldStream_loader(void *data)
+{
+	WorldStream *stream = (WorldStream *) data;
+	uint8_t buf[WORLD_CHUNK_BYTES];
+	WorldFileChunk *entry;
+	uint8_t *slot;
+	size_t chunk;
+
+	SDL_LockMutex(stream->lock);
+
+	while (!stream->quit) {
+		if (stream->req_len == 0) {
+			SDL_CondWait(stream->wake, stream->lock);
+			continue;
+		}
+
+		chunk = stream->requests[stream->req_head];
+		stream->req_head = (stream->req_head + 1) % stream->slot_count;
+		stream->req_len--;
+
+		entry = &stream->dir[chunk];
+		slot = &stream->slots[stream->chunk_slot[chunk] *
+				      WORLD_CHUNK_BYTES];
+
+		// read and decode without holding the lock
+		SDL_UnlockMutex(stream->lock);
+
+		if (fseek(stream->file, entry->offset, SEEK_SET) != 0 ||
+		    fread(buf, 1, entry->size, stream->file) != entry->size ||
+		    !WorldFile_decode_chunk(buf, entry, slot)) {
+			SM_log_err("World chunk could not be read.");
+			memset(slot, B_NONE, WORLD_CHUNK_BYTES);
+		}
+
+		SDL_LockMutex(stream->lock);
+		stream->loaded[stream->loaded_len++] = chunk;
+		SDL_CondSignal(stream->done);
+	}
+
+	SDL_UnlockMutex(stream->lock);
+
+	return 0;
+}
+
+static ChunkArea WorldStream_area(const World * world, const SDL_Rect * camera,
+				  const float offset_x, const float offset_y,
+				  const size_t radius)
+{
+	const float chunk_px = BLOCK_SIZE * WORLD_CHUNK_SIZE;
+	float bounds[4] = {
+		(camera->x + offset_x) / chunk_px - radius,
+		(camera->y + offset_y) / chunk_px - radius,
+		(camera->x + camera->w + offset_x) / chunk_px + radius,
+		(camera->y + camera->h + offset_y) / chunk_px + radius,
+	};
+	const float max[4] = {
+		world->chunks_w - 1, world->chunks_h - 1,
+		world->chunks_w - 1, world->chunks_h - 1,
+	};
+	ChunkArea area;
+
+	for (size_t i = 0; i < 4; i++) {
+		if (bounds[i] < 0.0f)
+			bounds[i] = 0.0f;
+
+		else if (bounds[i] > max[i])
+			bounds[i] = max[i];
+	}
+
+	area.x1 = bounds[0];
+	area.y1 = bounds[1];
+	area.x2 = bounds[2];
+	area.y2 = bounds[3];
+
+	return area;
+}
+
+static bool ChunkArea_contains(const ChunkArea * area, const size_t x,
+			       const size_t y)
+{
+	return x >= area->x1 && x <= area->x2 && y >= area->y1 &&
+	    y <= area->y2;
+}
+
+static size_t distance(const size_t a, const size_t b)
+{
+	return a > b ? a - b : b - a;
+}
+
+static int ChunkDistance_compare(const void *a, const void *b)
+{
+	const ChunkDistance *da = (const ChunkDistance *)a;
+	const ChunkDistance *db = (const ChunkDistance *)b;
+
+	// farthest first
+	return (da->distance < db->distance) - (da->distance > db->distance);
+}
+
+static void WorldStream_publish(World * world)
+{
+	WorldStream *stream = world->stream;
+	size_t chunk;
+
+	SDL_LockMutex(stream->lock);
+
+	for (size_t i = 0; i < stream->loaded_len; i++) {
+		chunk = stream->loaded[i];
+
+		world->chunks[chunk] =
+		    &stream->slots[stream->chunk_slot[chunk] *
+				   WORLD_CHUNK_BYTES];
+		World_update_solid(world, chunk);
+		world->flags[chunk] |= CF_REDRAW;
+		stream->state[chunk] = CS_RESIDENT;
+		stream->published[stream->published_len++] = chunk;
+	}
+
+	stream->loaded_len = 0;
+
+	SDL_UnlockMutex(stream->lock);
+}
+
+/* frees a batch of slots, farthest resident chunks outside of keep first */
+static void WorldStream_evict(World * world, const ChunkArea * keep,
+			      const size_t keep_len)
+{
+	WorldStream *stream = world->stream;
+	const size_t cx = (keep[0].x1 + keep[0].x2) / 2;
+	const size_t cy = (keep[0].y1 + keep[0].y2) / 2;
+	size_t count = 0;
+	size_t chunk;
+	size_t x, y;
+	bool kept;
+
+	for (size_t i = 0; i < stream->slot_count; i++) {
+		chunk = stream->slot_chunk[i];
+
+		if (chunk == SIZE_MAX || stream->state[chunk] != CS_RESIDENT)
+			continue;
+
+		x = chunk % world->chunks_w;
+		y = chunk / world->chunks_w;
+		kept = false;
+
+		for (size_t j = 0; j < keep_len; j++)
+			kept |= ChunkArea_contains(&keep[j], x, y);
+
+		if (kept)
+			continue;
+
+		stream->candidates[count].slot = i;
+		stream->candidates[count].distance =
+		    distance(x, cx) > distance(y, cy) ?
+		    distance(x, cx) : distance(y, cy);
+		count++;
+	}
+
+	qsort(stream->candidates, count, sizeof(ChunkDistance),
+	      ChunkDistance_compare);
+
+	// evict an eighth of the pool at once, so this stays rare
+	if (count > stream->slot_count / 8 + 1)
+		count = stream->slot_count / 8 + 1;
+
+	for (size_t i = 0; i < count; i++) {
+		chunk = stream->slot_chunk[stream->candidates[i].slot];
+
+		world->chunks[chunk] = (uint8_t *) EMPTY_CHUNK;
+		World_update_solid(world, chunk);
+		world->flags[chunk] |= CF_REDRAW;
+
+		stream->state[chunk] = CS_ABSENT;
+		stream->slot_chunk[stream->candidates[i].slot] = SIZE_MAX;
+		stream->free_slots[stream->free_count++] =
+		    stream->candidates[i].slot;
+	}
+}
+
+static bool WorldStream_request(World * world, const size_t chunk,
+				const ChunkArea * keep, const size_t keep_len)
+{
+	WorldStream *stream = world->stream;
+	size_t slot;
+
+	if (stream->state[chunk] != CS_ABSENT)
+		return true;
+
+	if (stream->free_count == 0)
+		WorldStream_evict(world, keep, keep_len);
+
+	if (stream->free_count == 0)
+		return false;
+
+	slot = stream->free_slots[--stream->free_count];
+	stream->slot_chunk[slot] = chunk;
+	stream->chunk_slot[chunk] = slot;
+	stream->state[chunk] = CS_QUEUED;
+
+	SDL_LockMutex(stream->lock);
+	stream->requests[(stream->req_head + stream->req_len) %
+			 stream->slot_count] = chunk;
+	stream->req_len++;
+	SDL_CondSignal(stream->wake);
+	SDL_UnlockMutex(stream->lock);
+
+	return true;
+}
+
+static bool WorldStream_request_in(World * world, const ChunkArea * area,
+				   const size_t x, const size_t y,
+				   const ChunkArea * keep,
+				   const size_t keep_len)
+{
+	if (!ChunkArea_contains(area, x, y))
+		return true;
+
+	return WorldStream_request(world, y * world->chunks_w + x, keep,
+				   keep_len);
+}
+
+/* requests an area in rings around its center, so the middle comes first */
+static bool WorldStream_request_area(World * world, const ChunkArea * area,
+				     const ChunkArea * keep,
+				     const size_t keep_len)
+{
+	const size_t cx = (area->x1 + area->x2) / 2;
+	const size_t cy = (area->y1 + area->y2) / 2;
+	size_t rings = area->x2 - cx;
+
+	if (cx - area->x1 > rings)
+		rings = cx - area->x1;
+
+	if (area->y2 - cy > rings)
+		rings = area->y2 - cy;
+
+	if (cy - area->y1 > rings)
+		rings = cy - area->y1;
+
+	for (size_t r = 0; r <= rings; r++) {
+		for (size_t y = area->y1; y <= area->y2; y++) {
+			// full row on the ring's edge
+			if (distance(y, cy) == r) {
+				for (size_t x = cx > r ? cx - r : 0;
+				     x <= cx + r; x++)
+					if (!WorldStream_request_in
+					    (world, area, x, y, keep, keep_len))
+						return false;
+			}
+			// else only both sides
+			else if (distance(y, cy) < r) {
+				if (cx >= r &&
+				    !WorldStream_request_in(world, area,
+							    cx - r, y, keep,
+							    keep_len))
+					return false;
+
+				if (!WorldStream_request_in(world, area, cx + r,
+							    y, keep, keep_len))
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool WorldStream_pending(const World * world, const ChunkArea * area)
+{
+	for (size_t y = area->y1; y <= area->y2; y++)
+		for (size_t x = area->x1; x <= area->x2; x++)
+			if (world->stream->state[y * world->chunks_w + x] ==
+			    CS_QUEUED)
+				return true;
+
+	return false;
+}
+
+World WorldStream_open(const char *path, const size_t radius,
+		       const size_t memory_cap)
+{
+	WorldFileChunk *dir;
+	WorldStream *stream;
+	World world = WorldFile_open(path, &dir);
+
+	if (world.invalid)
+		return world;
+
+	stream = calloc(1, sizeof(WorldStream));
+
+	if (stream == NULL) {
+		free(dir);
+		World_clear(&world);
+		world.invalid = true;
+		return world;
+	}
+
+	world.stream = stream;
+
+	stream->dir = dir;
+	stream->chunk_count = world.chunks_w * world.chunks_h;
+	stream->radius = radius;
+	stream->slot_count = memory_cap / WORLD_CHUNK_BYTES;
+
+	if (stream->slot_count < WORLDSTREAM_MIN_SLOTS)
+		stream->slot_count = WORLDSTREAM_MIN_SLOTS;
+
+	if (stream->slot_count > stream->chunk_count)
+		stream->slot_count = stream->chunk_count;
+
+	stream->state = calloc(stream->chunk_count, sizeof(uint8_t));
+	stream->chunk_slot = calloc(stream->chunk_count, sizeof(size_t));
+	stream->slots = malloc(stream->slot_count * WORLD_CHUNK_BYTES);
+	stream->slot_chunk = malloc(stream->slot_count * sizeof(size_t));
+	stream->free_slots = malloc(stream->slot_count * sizeof(size_t));
+	stream->candidates =
+	    malloc(stream->slot_count * sizeof(ChunkDistance));
+	stream->requests = malloc(stream->slot_count * sizeof(size_t));
+	stream->loaded = malloc(stream->slot_count * sizeof(size_t));
+	stream->published = malloc(stream->slot_count * sizeof(size_t));
+	stream->file = fopen(path, "rb");
+	stream->lock = SDL_CreateMutex();
+	stream->wake = SDL_CreateCond();
+	stream->done = SDL_CreateCond();
+
+	if (stream->state == NULL || stream->chunk_slot == NULL ||
+	    stream->slots == NULL || stream->slot_chunk == NULL ||
+	    stream->free_slots == NULL || stream->candidates == NULL ||
+	    stream->requests == NULL || stream->loaded == NULL ||
+	    stream->published == NULL || stream->file == NULL ||
+	    stream->lock == NULL || stream->wake == NULL ||
+	    stream->done == NULL) {
+		World_clear(&world);
+		world.invalid = true;
+		return world;
+	}
+
+	for (size_t i = 0; i < stream->slot_count; i++) {
+		stream->slot_chunk[i] = SIZE_MAX;
+		stream->free_slots[i] = stream->slot_count - 1 - i;
+	}
+
+	stream->free_count = stream->slot_count;
+
+	for (size_t i = 0; i < stream->chunk_count; i++)
+		world.chunks[i] = (uint8_t *) EMPTY_CHUNK;
+
+	stream->thread =
+	    SDL_CreateThread(WorldStream_loader, "world_stream", stream);
+
+	if (stream->thread == NULL) {
+		World_clear(&world);
+		world.invalid = true;
+		return world;
+	}
+
+	return world;
+}
+
+size_t WorldStream_update(World * world, const SDL_Rect * camera,
+			  const float velocity_x, const float velocity_y,
+			  const bool wait)
+{
+	WorldStream *stream = world->stream;
+	ChunkArea keep[2];
+
+	stream->published_len = 0;
+	WorldStream_publish(world);
+
+	// around the camera, and where the camera is heading
+	keep[0] = WorldStream_area(world, camera, 0.0f, 0.0f, stream->radius);
+	keep[1] = WorldStream_area(world, camera,
+				   velocity_x * WORLDSTREAM_LOOKAHEAD,
+				   velocity_y * WORLDSTREAM_LOOKAHEAD,
+				   stream->radius);
+
+	if (WorldStream_request_area(world, &keep[0], keep, 2))
+		WorldStream_request_area(world, &keep[1], keep, 2);
+
+	// block until the camera area is in, only used before the first frame
+	while (wait && WorldStream_pending(world, &keep[0])) {
+		SDL_LockMutex(stream->lock);
+
+		while (stream->loaded_len == 0)
+			SDL_CondWait(stream->done, stream->lock);
+
+		SDL_UnlockMutex(stream->lock);
+		WorldStream_publish(world);
+	}
+
+	return stream->published_len;
+}
+
+void WorldStream_clear(World * world)
+{
+	WorldStream *stream = world->stream;
+
+	if (stream == NULL)
+		return;
+
+	if (stream->thread != NULL) {
+		SDL_LockMutex(stream->lock);
+		stream->quit = true;
+		SDL_CondSignal(stream->wake);
+		SDL_UnlockMutex(stream->lock);
+
+		SDL_WaitThread(stream->thread, NULL);
+	}
+
+	if (stream->file != NULL)
+		fclose(stream->file);
+
+	if (stream->lock != NULL)
+		SDL_DestroyMutex(stream->lock);
+
+	if (stream->wake != NULL)
+		SDL_DestroyCond(stream->wake);
+
+	if (stream->done != NULL)
+		SDL_DestroyCond(stream->done);
+
+	free(stream->dir);
+	free(stream->state);
+	free(stream->chunk_slot);
+	free(stream->slots);
+	free(stream->slot_chunk);
+	free(stream->free_slots);
+	free(stream->candidates);
+	free(stream->requests);
+	free(stream->loaded);
+	free(stream->published);
+	free(stream);
+
+	world->stream = NULL;
+}
@@ -0,0 +1,101 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <SDL_render.h>
+#include "worldfile.h"
+#include "world.h"
+
+/*
+	Keeps only the chunks around the camera resident.
+	A loader thread reads and decodes requested chunks into a fixed pool
+	of slots, the main thread publishes them in WorldStream_update.
+	Chunks that are not resident point at an empty (all B_NONE) chunk,
+	so block access never waits for I/O. That chunk is read-only and
+	shared: World_set_block, World_edit_block and World_fill leave
+	chunks that are not resident alone, World_set_block and
+	World_edit_block return false for them.
+*/
+
+static const float WORLDSTREAM_LOOKAHEAD = 1.0f;
+static const size_t WORLDSTREAM_MIN_SLOTS = 256;
+
+typedef enum ChunkState {
+	CS_ABSENT,
+	CS_QUEUED,
+	CS_RESIDENT,
+} ChunkState;
+
+typedef struct ChunkDistance {
+	size_t slot;
+	size_t distance;
+} ChunkDistance;
+
+struct WorldStream {
+	FILE *file;
+	WorldFileChunk *dir;
+	size_t chunk_count;
+	size_t radius;
+	uint8_t *state;
+	size_t *chunk_slot;
+
+	size_t slot_count;
+	uint8_t *slots;
+	size_t *slot_chunk;
+	size_t *free_slots;
+	size_t free_count;
+	ChunkDistance *candidates;
+
+	size_t *requests;
+	size_t req_head;
+	size_t req_len;
+	size_t *loaded;
+	size_t loaded_len;
+	size_t *published;
+	size_t published_len;
+
+	bool quit;
+	SDL_Thread *thread;
+	SDL_mutex *lock;
+	SDL_cond *wake;
+	SDL_cond *done;
+};
+
+/* whether a chunk holds its real blocks, always true without streaming */
+static inline bool WorldStream_resident(const World * world,
+					const size_t chunk)
+{
+	return world->stream == NULL ||
+	    world->stream->state[chunk] == CS_RESIDENT;
+}
+
+World WorldStream_open(const char *path, const size_t radius,
+		       const size_t memory_cap);
+
+size_t WorldStream_update(World * world, const SDL_Rect * camera,
+			  const float velocity_x, const float velocity_y,
+			  const bool wait);
+
+void WorldStream_clear(World * world);
+
+#endif				// STREAM_H
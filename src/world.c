@@ -19,14 +19,103 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <SM_log.h>
+#include <SG_world.h>
 #include "path.h"
 #include "entity.h"
+#include "worldfile.h"
+#include "stream.h"
 #include "world.h"
 
-SG_World World_new(const size_t width, const size_t height)
+World World_alloc(const size_t width, const size_t height,
+		  const size_t ent_count, const bool alloc_chunks)
 {
-	SG_World world = SG_World_new(BLOCK_SIZE, width, height, 2);
+	World world = {
+		.invalid = false,
+		.width = width,
+		.height = height,
+		.created = time(NULL),
+		.chunks_w = (width + WORLD_CHUNK_MASK) >> WORLD_CHUNK_SHIFT,
+		.chunks_h = (height + WORLD_CHUNK_MASK) >> WORLD_CHUNK_SHIFT,
+		.solid_stride = (width + WORLD_SOLID_MASK) >> WORLD_SOLID_SHIFT,
+		.ent_count = ent_count,
+	};
+	size_t chunks = world.chunks_w * world.chunks_h;
+
+	world.chunks = calloc(chunks, sizeof(uint8_t *));
+	world.solid = calloc(world.solid_stride * height, sizeof(uint64_t));
+	world.cover = calloc(world.solid_stride * height, sizeof(uint64_t));
+	world.rects = calloc(chunks, sizeof(WorldRect *));
+	world.rect_count = calloc(chunks, sizeof(uint16_t));
+	world.flags = calloc(chunks, sizeof(uint8_t));
+	world.entities = calloc(ent_count, sizeof(SG_Entity));
+
+	if (world.chunks == NULL || world.solid == NULL ||
+	    world.cover == NULL || world.rects == NULL ||
+	    world.rect_count == NULL || world.flags == NULL ||
+	    (ent_count > 0 && world.entities == NULL)) {
+		World_clear(&world);
+		world.invalid = true;
+		return world;
+	}
+
+	if (!alloc_chunks)
+		return world;
+
+	world.chunk_data = malloc(chunks * WORLD_CHUNK_BYTES);
+
+	if (world.chunk_data == NULL) {
+		World_clear(&world);
+		world.invalid = true;
+		return world;
+	}
+
+	for (size_t i = 0; i < chunks; i++)
+		world.chunks[i] = &world.chunk_data[i * WORLD_CHUNK_BYTES];
+
+	// one memset for every layer of every chunk, including padding
+	memset(world.chunk_data, B_NONE, chunks * WORLD_CHUNK_BYTES);
+
+	// nothing of it is on disk yet
+	memset(world.flags, CF_DIRTY, chunks);
+	world.dirty_count = chunks;
+
+	return world;
+}
+
+/* converts a world in the old schoki_game format into chunked storage */
+static World World_from_sg(SG_World * sg)
+{
+	World world = World_alloc(sg->width, sg->height, sg->ent_count, true);
+
+	if (world.invalid)
+		return world;
+
+	for (size_t x = 0; x < sg->width; x++) {
+		for (size_t y = 0; y < sg->height; y++) {
+			World_set_block(&world, x, y, L_BLOCK,
+					sg->blocks[x][y][L_BLOCK]);
+			World_set_block(&world, x, y, L_WALL,
+					sg->blocks[x][y][L_WALL]);
+		}
+	}
+
+	memcpy(world.entities, sg->entities,
+	       sg->ent_count * sizeof(SG_Entity));
+	World_rebuild_solid(&world);
+
+	return world;
+}
+
+World World_new(const size_t width, const size_t height)
+{
+	World world = World_alloc(width, height, 1, true);
+
+	if (world.invalid)
+		return world;
 
 	// set values
 	world.entities[0].id = E_PLAYER;
@@ -41,23 +130,29 @@ SG_World World_new(const size_t width, const size_t height)
 	return world;
 }
 
-SG_World World_from_file(const char *world_name)
+World World_from_file(const char *world_name)
 {
-	SG_World world;
+	World world = {.invalid = true };
+	SG_World sg;
 	SM_String filepath = SM_String_new(8);
 
 	// get path
-	if (get_world_path(&filepath) != 0) {
-		world.invalid = true;
+	if (get_world_filepath(&filepath, world_name) != 0) {
+		SM_String_clear(&filepath);
 		return world;
 	}
 
-	SM_String_append_cstr(&filepath, world_name);
-	SM_String_append_cstr(&filepath, ".");
-	SM_String_append_cstr(&filepath, FILETYPE_WORLD);
+	// read, current format is mapped, old format is converted
+	if (WorldFile_detect(filepath.str)) {
+		world = WorldFile_read(filepath.str);
+	} else {
+		sg = SG_World_from_file(filepath.str);
 
-	// read
-	world = SG_World_from_file(filepath.str);
+		if (!sg.invalid) {
+			world = World_from_sg(&sg);
+			SG_World_clear(&sg);
+		}
+	}
 
 	if (world.invalid) {
 		SM_String msg = SM_String_new(16);
@@ -72,31 +167,563 @@ SG_World World_from_file(const char *world_name)
 	return world;
 }
 
-void World_write(SG_World * world, const char *world_name)
+World World_stream_from_file(const char *world_name, const size_t radius,
+			     const size_t memory_cap)
+{
+	World world = {.invalid = true };
+	SM_String filepath = SM_String_new(8);
+
+	// get path
+	if (get_world_filepath(&filepath, world_name) != 0) {
+		SM_String_clear(&filepath);
+		return world;
+	}
+
+	// only the current format has a chunk directory to stream from
+	if (!WorldFile_detect(filepath.str)) {
+		SM_String_clear(&filepath);
+		return World_from_file(world_name);
+	}
+
+	world = WorldStream_open(filepath.str, radius, memory_cap);
+
+	if (world.invalid) {
+		SM_String msg = SM_String_new(16);
+		SM_String_copy_cstr(&msg, "World \"");
+		SM_String_append_cstr(&msg, world_name);
+		SM_String_append_cstr(&msg, "\" could not be opened.");
+		SM_log_err(msg.str);
+		SM_String_clear(&msg);
+	}
+
+	SM_String_clear(&filepath);
+	return world;
+}
+
+void World_write(World * world, const char *world_name, const bool compress)
 {
 	SM_String filepath = SM_String_new(8);
 
 	// get path
-	if (get_world_path(&filepath) != 0) {
+	if (get_world_filepath(&filepath, world_name) != 0) {
+		SM_String_clear(&filepath);
 		world->invalid = true;
 		return;
 	}
 
-	SM_String_append_cstr(&filepath, world_name);
-	SM_String_append_cstr(&filepath, ".");
-	SM_String_append_cstr(&filepath, FILETYPE_WORLD);
+	// write, only changed chunks if the file on disk allows it
+	if (WorldFile_write_dirty(world, filepath.str, compress, NULL)) {
+		for (size_t i = 0; i < world->chunks_w * world->chunks_h; i++)
+			world->flags[i] &= ~CF_DIRTY;
 
-	// write
-	SG_World_write(world, filepath.str);
+		world->dirty_count = 0;
+	} else {
+		world->invalid = true;
 
-	if (world->invalid) {
 		SM_String msg = SM_String_new(16);
 		SM_String_copy_cstr(&msg, "World \"");
 		SM_String_append_cstr(&msg, world_name);
-		SM_String_append_cstr(&msg, "\" could not be read.");
+		SM_String_append_cstr(&msg, "\" could not be written.");
 		SM_log_err(msg.str);
 		SM_String_clear(&msg);
 	}
 
 	SM_String_clear(&filepath);
 }
+
+/* converts to palette planes, not for streamed worlds or during a save */
+bool World_pack(World * world)
+{
+	const size_t chunks = world->chunks_w * world->chunks_h;
+	PackedPlane *packed;
+
+	if (world->packed != NULL)
+		return true;
+
+	if (world->stream != NULL || world->saving)
+		return false;
+
+	packed = calloc(chunks * WORLD_LAYERS, sizeof(PackedPlane));
+
+	if (packed == NULL)
+		return false;
+
+	for (size_t i = 0; i < chunks * WORLD_LAYERS; i++) {
+		if (PackedPlane_pack(&packed[i], WORLD_CHUNK_AREA,
+				     &world->chunks[i / WORLD_LAYERS]
+				     [(i % WORLD_LAYERS) * WORLD_CHUNK_AREA]))
+			continue;
+
+		for (size_t k = 0; k < i; k++)
+			PackedPlane_clear(&packed[k]);
+
+		free(packed);
+		return false;
+	}
+
+	// raw storage is not needed anymore
+	for (size_t i = 0; i < chunks; i++) {
+		if (world->flags[i] & CF_OWNED)
+			free(world->chunks[i]);
+
+		world->flags[i] |= CF_OWNED;
+	}
+
+	WorldFile_unmap(world);
+	free(world->chunk_data);
+	free(world->chunks);
+
+	world->chunk_data = NULL;
+	world->chunks = NULL;
+	world->packed = packed;
+
+	return true;
+}
+
+/* callers must thaw frozen chunks first, widening frees the old indices */
+bool World_set_packed(World * world, size_t x, size_t y, Layer layer,
+		      Block block)
+{
+	return PackedPlane_set(&world->packed[World_chunk_index(world, x, y) *
+					      WORLD_LAYERS + layer],
+			       WORLD_CHUNK_AREA, World_cell_index(x, y),
+			       (uint8_t) block);
+}
+
+/* raw layers of a chunk, packed chunks get unpacked into buf */
+const uint8_t *World_chunk_raw(const World * world, const size_t chunk,
+			       uint8_t * buf)
+{
+	if (world->packed == NULL)
+		return world->chunks[chunk];
+
+	for (size_t l = 0; l < WORLD_LAYERS; l++)
+		PackedPlane_unpack(&world->packed[chunk * WORLD_LAYERS + l],
+				   WORLD_CHUNK_AREA, &buf[l * WORLD_CHUNK_AREA]);
+
+	return buf;
+}
+
+WorldMemory World_memory(const World * world)
+{
+	const size_t chunks = world->chunks_w * world->chunks_h;
+	const uint8_t *map = world->map;
+	const PackedPlane *plane;
+	WorldMemory mem = {
+		.tables = chunks * sizeof(uint8_t) +
+		    2 * world->solid_stride * world->height * sizeof(uint64_t) +
+		    chunks * (sizeof(WorldRect *) + sizeof(uint16_t)),
+		.entities = world->ent_count * sizeof(SG_Entity),
+	};
+
+	for (size_t i = 0; i < chunks; i++)
+		if (world->rect_count[i] != WORLD_RECTS_NONE)
+			mem.tables += world->rect_count[i] * sizeof(WorldRect);
+
+	if (world->packed != NULL) {
+		mem.tables += chunks * WORLD_LAYERS * sizeof(PackedPlane);
+
+		for (size_t i = 0; i < chunks * WORLD_LAYERS; i++) {
+			plane = &world->packed[i];
+			mem.blocks += PackedPlane_size(plane, WORLD_CHUNK_AREA);
+			mem.planes[plane->bits == PACKED_DIRECT ? 4 :
+				   plane->bits == 4 ? 3 : plane->bits]++;
+		}
+
+		return mem;
+	}
+
+	mem.tables += chunks * sizeof(uint8_t *);
+
+	// streamed worlds hold a fixed pool of slots
+	if (world->stream != NULL) {
+		mem.blocks = world->stream->slot_count * WORLD_CHUNK_BYTES;
+		return mem;
+	}
+
+	for (size_t i = 0; i < chunks; i++) {
+		if (map != NULL && world->chunks[i] >= map &&
+		    world->chunks[i] < map + world->map_size)
+			mem.mapped += WORLD_CHUNK_BYTES;
+		else
+			mem.blocks += WORLD_CHUNK_BYTES;
+	}
+
+	return mem;
+}
+
+/*
+	Greedy meshing of the solid tiles of a chunk: the first run of a row
+	grows down as long as the rows below hold all of it. A chunk row is
+	32 bits of one solid word. Without memory the chunk gets
+	WORLD_RECTS_NONE.
+*/
+static void World_update_rects(World * world, const size_t chunk)
+{
+	const size_t x1 = (chunk % world->chunks_w) << WORLD_CHUNK_SHIFT;
+	const size_t y1 = (chunk / world->chunks_w) << WORLD_CHUNK_SHIFT;
+	uint32_t rows[WORLD_CHUNK_SIZE];
+	WorldRect found[WORLD_CHUNK_AREA / 2];
+	WorldRect *rects;
+	size_t count = 0;
+	size_t x, w, h;
+	uint32_t run, mask;
+
+	for (size_t y = 0; y < WORLD_CHUNK_SIZE; y++)
+		rows[y] = y1 + y >= world->height ? 0 :
+		    (uint32_t) (world->solid[(y1 + y) * world->solid_stride +
+					     (x1 >> WORLD_SOLID_SHIFT)] >>
+				(x1 & WORLD_SOLID_MASK));
+
+	for (size_t y = 0; y < WORLD_CHUNK_SIZE; y++) {
+		while (rows[y] != 0) {
+			x = World_solid_first(rows[y]);
+			run = ~(rows[y] >> x);
+			w = run == 0 ? WORLD_CHUNK_SIZE - x :
+			    World_solid_first(run);
+			mask = (w == WORLD_CHUNK_SIZE ? UINT32_MAX :
+				((uint32_t) 1 << w) - 1) << x;
+
+			for (h = 1; y + h < WORLD_CHUNK_SIZE &&
+			     (rows[y + h] & mask) == mask; h++) ;
+
+			for (size_t k = 0; k < h; k++)
+				rows[y + k] &= ~mask;
+
+			found[count].x = x;
+			found[count].y = y;
+			found[count].w = w;
+			found[count].h = h;
+			count++;
+		}
+	}
+
+	if (count == 0) {
+		free(world->rects[chunk]);
+		world->rects[chunk] = NULL;
+		world->rect_count[chunk] = 0;
+		return;
+	}
+
+	rects = realloc(world->rects[chunk], count * sizeof(WorldRect));
+
+	if (rects == NULL) {
+		free(world->rects[chunk]);
+		world->rects[chunk] = NULL;
+		world->rect_count[chunk] = WORLD_RECTS_NONE;
+		return;
+	}
+
+	memcpy(rects, found, count * sizeof(WorldRect));
+	world->rects[chunk] = rects;
+	world->rect_count[chunk] = count;
+}
+
+/* recomputes the solid bits of a chunk after its blocks were replaced */
+void World_update_solid(World * world, const size_t chunk)
+{
+	const size_t x1 = (chunk % world->chunks_w) << WORLD_CHUNK_SHIFT;
+	const size_t y1 = (chunk / world->chunks_w) << WORLD_CHUNK_SHIFT;
+	size_t x2 = x1 + WORLD_CHUNK_SIZE;
+	size_t y2 = y1 + WORLD_CHUNK_SIZE;
+	Block block;
+
+	if (x2 > world->width)
+		x2 = world->width;
+
+	if (y2 > world->height)
+		y2 = world->height;
+
+	for (size_t y = y1; y < y2; y++)
+		for (size_t x = x1; x < x2; x++) {
+			block = World_get_block(world, x, y, L_BLOCK);
+			World_set_solid(world, x, y, block != B_NONE);
+			World_set_cover(world, x, y, BLOCK_OPAQUE[block]);
+		}
+
+	World_update_rects(world, chunk);
+}
+
+void World_rebuild_solid(World * world)
+{
+	for (size_t i = 0; i < world->chunks_w * world->chunks_h; i++)
+		World_update_solid(world, i);
+}
+
+/* gives a frozen packed chunk its own index data */
+static bool World_thaw_packed(World * world, const size_t chunk)
+{
+	PackedPlane *planes = &world->packed[chunk * WORLD_LAYERS];
+	PackedPlane copy[WORLD_LAYERS];
+	uint8_t **retired;
+
+	retired = realloc(world->retired, (world->retired_len + WORLD_LAYERS) *
+			  sizeof(uint8_t *));
+
+	if (retired == NULL)
+		return false;
+
+	world->retired = retired;
+	memcpy(copy, planes, sizeof(copy));
+
+	for (size_t l = 0; l < WORLD_LAYERS; l++) {
+		if (PackedPlane_copy(&copy[l], WORLD_CHUNK_AREA))
+			continue;
+
+		for (size_t k = 0; k < l; k++)
+			if (copy[k].data != planes[k].data)
+				free(copy[k].data);
+
+		return false;
+	}
+
+	for (size_t l = 0; l < WORLD_LAYERS; l++)
+		if (planes[l].data != NULL)
+			world->retired[world->retired_len++] = planes[l].data;
+
+	memcpy(planes, copy, sizeof(copy));
+	world->flags[chunk] &= ~CF_FROZEN;
+
+	return true;
+}
+
+/* gives a frozen chunk its own copy, the snapshot keeps the old one */
+bool World_thaw_chunk(World * world, const size_t chunk)
+{
+	uint8_t **retired;
+	uint8_t *copy;
+
+	if (world->packed != NULL)
+		return World_thaw_packed(world, chunk);
+
+	copy = malloc(WORLD_CHUNK_BYTES);
+
+	if (copy == NULL)
+		return false;
+
+	// an own allocation can only be freed once the snapshot is done
+	if (world->flags[chunk] & CF_OWNED) {
+		retired = realloc(world->retired,
+				  (world->retired_len + 1) * sizeof(uint8_t *));
+
+		if (retired == NULL) {
+			free(copy);
+			return false;
+		}
+
+		world->retired = retired;
+		world->retired[world->retired_len++] = world->chunks[chunk];
+	}
+
+	memcpy(copy, world->chunks[chunk], WORLD_CHUNK_BYTES);
+	world->chunks[chunk] = copy;
+	world->flags[chunk] = (world->flags[chunk] & ~CF_FROZEN) | CF_OWNED;
+
+	return true;
+}
+
+World World_snapshot(World * world)
+{
+	const size_t chunks = world->chunks_w * world->chunks_h;
+	World snapshot = {
+		.invalid = false,
+		.width = world->width,
+		.height = world->height,
+		.created = world->created,
+		.chunks_w = world->chunks_w,
+		.chunks_h = world->chunks_h,
+		.dirty_count = world->dirty_count,
+		.ent_count = world->ent_count,
+	};
+
+	if (world->packed != NULL)
+		snapshot.packed =
+		    malloc(chunks * WORLD_LAYERS * sizeof(PackedPlane));
+	else
+		snapshot.chunks = malloc(chunks * sizeof(uint8_t *));
+
+	snapshot.flags = malloc(chunks * sizeof(uint8_t));
+	snapshot.entities = malloc(world->ent_count * sizeof(SG_Entity));
+
+	if ((snapshot.chunks == NULL && snapshot.packed == NULL) ||
+	    snapshot.flags == NULL ||
+	    (world->ent_count > 0 && snapshot.entities == NULL)) {
+		World_clear(&snapshot);
+		snapshot.invalid = true;
+		return snapshot;
+	}
+
+	// share every chunk, edits copy them from now on
+	if (world->packed != NULL)
+		memcpy(snapshot.packed, world->packed,
+		       chunks * WORLD_LAYERS * sizeof(PackedPlane));
+	else
+		memcpy(snapshot.chunks, world->chunks,
+		       chunks * sizeof(uint8_t *));
+
+	memcpy(snapshot.entities, world->entities,
+	       world->ent_count * sizeof(SG_Entity));
+
+	for (size_t i = 0; i < chunks; i++) {
+		snapshot.flags[i] = world->flags[i] & CF_DIRTY;
+		world->flags[i] = (world->flags[i] & ~CF_DIRTY) | CF_FROZEN;
+	}
+
+	world->dirty_count = 0;
+	world->saving = true;
+
+	return snapshot;
+}
+
+void World_release_snapshot(World * world, World * snapshot,
+			    const bool saved)
+{
+	const size_t chunks = world->chunks_w * world->chunks_h;
+
+	for (size_t i = 0; i < world->retired_len; i++)
+		free(world->retired[i]);
+
+	free(world->retired);
+	world->retired = NULL;
+	world->retired_len = 0;
+	world->saving = false;
+
+	for (size_t i = 0; i < chunks; i++) {
+		world->flags[i] &= ~CF_FROZEN;
+
+		// failed saves leave their chunks dirty
+		if (!saved && (snapshot->flags[i] & CF_DIRTY) &&
+		    !(world->flags[i] & CF_DIRTY)) {
+			world->flags[i] |= CF_DIRTY;
+			world->dirty_count++;
+		}
+	}
+
+	World_clear(snapshot);
+}
+
+bool World_resident(const World * world, const size_t chunk)
+{
+	return WorldStream_resident(world, chunk);
+}
+
+bool World_edit_block(World * world, const size_t x, const size_t y,
+		      const Layer layer, const Block block)
+{
+	const size_t chunk = World_chunk_index(world, x, y);
+
+	if (x >= world->width || y >= world->height)
+		return false;
+
+	if (!WorldStream_resident(world, chunk))
+		return false;
+
+	if ((world->flags[chunk] & CF_FROZEN) &&
+	    !World_thaw_chunk(world, chunk))
+		return false;
+
+	if (!World_set_block(world, x, y, layer, block))
+		return false;
+
+	if (!(world->flags[chunk] & CF_DIRTY)) {
+		world->flags[chunk] |= CF_DIRTY;
+		world->dirty_count++;
+	}
+
+	world->flags[chunk] |= CF_REDRAW;
+
+	// only the block layer collides
+	if (layer == L_BLOCK) {
+		World_update_rects(world, chunk);
+
+		if (!(world->flags[chunk] & CF_EDITED)) {
+			world->flags[chunk] |= CF_EDITED;
+			world->edited_count++;
+		}
+	}
+
+	return true;
+}
+
+void World_fill(World * world, Layer layer, Block block)
+{
+	const size_t chunks = world->chunks_w * world->chunks_h;
+
+	// each layer is one contiguous plane per chunk
+	for (size_t i = 0; i < chunks; i++) {
+		if (!WorldStream_resident(world, i))
+			continue;
+
+		if ((world->flags[i] & CF_FROZEN) &&
+		    !World_thaw_chunk(world, i))
+			continue;
+
+		if (world->packed != NULL)
+			PackedPlane_fill(&world->packed[i * WORLD_LAYERS +
+							layer], block);
+		else
+			memset(&world->chunks[i][layer * WORLD_CHUNK_AREA],
+			       block, WORLD_CHUNK_AREA);
+
+		if (!(world->flags[i] & CF_DIRTY)) {
+			world->flags[i] |= CF_DIRTY;
+			world->dirty_count++;
+		}
+
+		world->flags[i] |= CF_REDRAW;
+	}
+
+	if (layer == L_BLOCK)
+		World_rebuild_solid(world);
+}
+
+void World_clear(World * world)
+{
+	WorldStream_clear(world);
+	WorldFile_unmap(world);
+
+	if (world->flags != NULL && world->packed != NULL) {
+		for (size_t i = 0; i < world->chunks_w * world->chunks_h; i++)
+			if (world->flags[i] & CF_OWNED)
+				for (size_t l = 0; l < WORLD_LAYERS; l++)
+					PackedPlane_clear(&world->packed
+							  [i * WORLD_LAYERS +
+							   l]);
+	} else if (world->flags != NULL) {
+		for (size_t i = 0; i < world->chunks_w * world->chunks_h; i++)
+			if (world->flags[i] & CF_OWNED)
+				free(world->chunks[i]);
+	}
+
+	for (size_t i = 0; i < world->retired_len; i++)
+		free(world->retired[i]);
+
+	if (world->rects != NULL)
+		for (size_t i = 0; i < world->chunks_w * world->chunks_h; i++)
+			free(world->rects[i]);
+
+	free(world->chunks);
+	free(world->packed);
+	free(world->solid);
+	free(world->cover);
+	free(world->rects);
+	free(world->rect_count);
+	free(world->flags);
+	free(world->retired);
+	free(world->chunk_data);
+	free(world->entities);
+
+	world->chunks = NULL;
+	world->packed = NULL;
+	world->solid = NULL;
+	world->cover = NULL;
+	world->rects = NULL;
+	world->rect_count = NULL;
+	world->flags = NULL;
+	world->retired = NULL;
+	world->retired_len = 0;
+	world->saving = false;
+	world->chunk_data = NULL;
+	world->entities = NULL;
+	world->ent_count = 0;
+}
@@ -20,12 +20,297 @@
 #ifndef WORLD_H
 #define WORLD_H
 
-#include <SG_world.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <SDL_render.h>
+#include <SG_entity.h>
+#include "block.h"
+#include "packed.h"
 
-SG_World World_new(const size_t width, const size_t height);
+/*
+	Blocks are stored in square chunks of WORLD_CHUNK_SIZE tiles.
+	Every chunk holds one plane per layer, each plane is row-major:
+
+	chunks[i] -> [layer 0 plane][layer 1 plane]
+
+	Chunk storage either lives in chunk_data, is mapped straight from
+	the world file (see worldfile.h) or is paged in around the camera
+	(see stream.h).
+	A packed world (see World_pack) has no chunk table, every layer of
+	every chunk is a palette plane instead: packed[chunk * LAYERS + layer].
+
+	Collision reads the solid mask instead of blocks: one bit per tile,
+	set where L_BLOCK is not B_NONE, each row packed into solid_stride
+	64 bit words. Every path that changes blocks keeps it in sync.
+	World_update_solid and World_edit_block also merge the solid tiles
+	of a chunk into few rects (greedy meshing, rows first), for queries
+	that cross whole chunks at once (see query.h). World_set_block
+	alone leaves the rects stale.
+	The cover mask has the same layout, set where L_BLOCK is opaque
+	(BLOCK_OPAQUE), so drawing skips the walls behind without reading
+	them. It is kept with the solid mask, per chunk when one is loaded
+	and per tile on edits, never per frame.
+*/
+#define WORLD_CHUNK_SHIFT 5
+#define WORLD_CHUNK_SIZE (1 << WORLD_CHUNK_SHIFT)
+#define WORLD_CHUNK_MASK (WORLD_CHUNK_SIZE - 1)
+#define WORLD_CHUNK_AREA (WORLD_CHUNK_SIZE * WORLD_CHUNK_SIZE)
+#define WORLD_LAYERS 2
+#define WORLD_CHUNK_BYTES (WORLD_LAYERS * WORLD_CHUNK_AREA)
+#define WORLD_SOLID_SHIFT 6
+#define WORLD_SOLID_MASK ((1 << WORLD_SOLID_SHIFT) - 1)
+
+typedef enum Layer {
+	L_BLOCK,
+	L_WALL,
+
+	L_LAST = L_WALL,
+} Layer;
+
+typedef enum ChunkFlag {
+	CF_DIRTY = 1 << 0,	/* changed since the last save */
+	CF_FROZEN = 1 << 1,	/* shared with a save snapshot */
+	CF_OWNED = 1 << 2,	/* own allocation, see World_thaw_chunk */
+	CF_EDITED = 1 << 3,	/* blocks edited, entities around may wake */
+	CF_REDRAW = 1 << 4,	/* tiles changed since drawn, see cache.h */
+} ChunkFlag;
+
+/* merged solid tiles of a chunk, in tiles from the chunk origin */
+typedef struct WorldRect {
+	uint8_t x;
+	uint8_t y;
+	uint8_t w;
+	uint8_t h;
+} WorldRect;
+
+// rect_count of a chunk without rects, its tiles have to be read
+#define WORLD_RECTS_NONE UINT16_MAX
+
+typedef struct WorldStream WorldStream;
+
+typedef struct World {
+	bool invalid;
+	size_t width;
+	size_t height;
+	int64_t created;
+	size_t chunks_w;
+	size_t chunks_h;
+	uint8_t **chunks;
+	uint8_t *chunk_data;
+	PackedPlane *packed;
+	void *map;
+	size_t map_size;
+	WorldStream *stream;
+	uint64_t *solid;
+	uint64_t *cover;
+	size_t solid_stride;
+	WorldRect **rects;
+	uint16_t *rect_count;
+	uint8_t *flags;
+	size_t dirty_count;
+	size_t edited_count;
+	uint8_t **retired;
+	size_t retired_len;
+	bool saving;		/* a save snapshot shares the chunks */
+	size_t ent_count;
+	SG_Entity *entities;
+} World;
+
+typedef struct WorldMemory {
+	size_t tables;		/* chunk table, flags, planes, collision */
+	size_t blocks;		/* block storage on the heap */
+	size_t mapped;		/* block storage in the file mapping */
+	size_t entities;
+	size_t planes[5];	/* packed planes by width: 0, 1, 2, 4, 8 bits */
+} WorldMemory;
+
+static inline size_t World_chunk_index(const World * world, size_t x,
+				       size_t y)
+{
+	return (y >> WORLD_CHUNK_SHIFT) * world->chunks_w +
+	    (x >> WORLD_CHUNK_SHIFT);
+}
+
+static inline size_t World_cell_index(size_t x, size_t y)
+{
+	return ((y & WORLD_CHUNK_MASK) << WORLD_CHUNK_SHIFT) +
+	    (x & WORLD_CHUNK_MASK);
+}
+
+static inline size_t World_plane_index(size_t x, size_t y, Layer layer)
+{
+	return (layer << (WORLD_CHUNK_SHIFT * 2)) + World_cell_index(x, y);
+}
+
+static inline Block World_get_block(const World * world, size_t x, size_t y,
+				    Layer layer)
+{
+	if (world->packed != NULL)
+		return (Block) PackedPlane_get(&world->packed
+					       [World_chunk_index(world, x, y) *
+						WORLD_LAYERS + layer],
+					       World_cell_index(x, y));
+
+	return (Block) world->chunks[World_chunk_index(world, x, y)]
+	    [World_plane_index(x, y, layer)];
+}
+
+static inline bool World_is_solid(const World * world, size_t x, size_t y)
+{
+	return (world->solid[y * world->solid_stride + (x >> WORLD_SOLID_SHIFT)]
+		>> (x & WORLD_SOLID_MASK)) & 1;
+}
+
+static inline void World_set_solid(World * world, size_t x, size_t y,
+				   bool solid)
+{
+	uint64_t *word =
+	    &world->solid[y * world->solid_stride + (x >> WORLD_SOLID_SHIFT)];
+	const uint64_t bit = (uint64_t) 1 << (x & WORLD_SOLID_MASK);
+
+	if (solid)
+		*word |= bit;
+	else
+		*word &= ~bit;
+}
+
+static inline bool World_is_covered(const World * world, size_t x,
+				    size_t y)
+{
+	return (world->cover[y * world->solid_stride + (x >> WORLD_SOLID_SHIFT)]
+		>> (x & WORLD_SOLID_MASK)) & 1;
+}
+
+static inline void World_set_cover(World * world, size_t x, size_t y,
+				   bool cover)
+{
+	uint64_t *word =
+	    &world->cover[y * world->solid_stride + (x >> WORLD_SOLID_SHIFT)];
+	const uint64_t bit = (uint64_t) 1 << (x & WORLD_SOLID_MASK);
+
+	if (cover)
+		*word |= bit;
+	else
+		*word &= ~bit;
+}
+
+/* solid bits of word w in row y, limited to the columns x1 to x2 */
+static inline uint64_t World_solid_word(const World * world, size_t w,
+					size_t y, size_t x1, size_t x2)
+{
+	uint64_t bits = world->solid[y * world->solid_stride + w];
+
+	if (w == x1 >> WORLD_SOLID_SHIFT)
+		bits &= ~(uint64_t) 0 << (x1 & WORLD_SOLID_MASK);
+
+	if (w == x2 >> WORLD_SOLID_SHIFT)
+		bits &= ~(uint64_t) 0 >> (WORLD_SOLID_MASK -
+					 (x2 & WORLD_SOLID_MASK));
+
+	return bits;
+}
+
+/* index of the lowest set bit, bits must not be 0 */
+static inline size_t World_solid_first(uint64_t bits)
+{
+#ifdef __GNUC__
+	return __builtin_ctzll(bits);
+#else
+	size_t i = 0;
+
+	while (!(bits & 1)) {
+		bits >>= 1;
+		i++;
+	}
+
+	return i;
+#endif
+}
+
+/* index of the highest set bit, bits must not be 0 */
+static inline size_t World_solid_last(uint64_t bits)
+{
+#ifdef __GNUC__
+	return WORLD_SOLID_MASK - __builtin_clzll(bits);
+#else
+	size_t i = WORLD_SOLID_MASK;
+
+	while (!(bits >> i))
+		i--;
+
+	return i;
+#endif
+}
+
+bool World_set_packed(World * world, size_t x, size_t y, Layer layer,
+		      Block block);
+
+bool World_resident(const World * world, const size_t chunk);
+
+/*
+	Fails for packed worlds when a plane can not be widened, and for
+	chunks a WorldStream has not loaded (see stream.h).
+*/
+static inline bool World_set_block(World * world, size_t x, size_t y,
+				   Layer layer, Block block)
+{
+	const size_t chunk = World_chunk_index(world, x, y);
+
+	if (world->stream != NULL && !World_resident(world, chunk))
+		return false;
+
+	if (world->packed != NULL) {
+		if (!World_set_packed(world, x, y, layer, block))
+			return false;
+	} else {
+		world->chunks[chunk][World_plane_index(x, y, layer)] =
+		    (uint8_t) block;
+	}
+
+	if (layer == L_BLOCK) {
+		World_set_solid(world, x, y, block != B_NONE);
+		World_set_cover(world, x, y, BLOCK_OPAQUE[block]);
+	}
+
+	return true;
+}
+
+World World_alloc(const size_t width, const size_t height,
+		  const size_t ent_count, const bool alloc_chunks);
+
+World World_new(const size_t width, const size_t height);
+
+World World_from_file(const char *world_name);
+
+World World_stream_from_file(const char *world_name, const size_t radius,
+			     const size_t memory_cap);
+
+void World_write(World * world, const char *world_name, const bool compress);
+
+bool World_pack(World * world);
+
+const uint8_t *World_chunk_raw(const World * world, const size_t chunk,
+			       uint8_t * buf);
+
+WorldMemory World_memory(const World * world);
+
+void World_update_solid(World * world, const size_t chunk);
+
+void World_rebuild_solid(World * world);
+
+bool World_thaw_chunk(World * world, const size_t chunk);
+
+World World_snapshot(World * world);
+
+void World_release_snapshot(World * world, World * snapshot,
+			    const bool saved);
+
+bool World_edit_block(World * world, const size_t x, const size_t y,
+		      const Layer layer, const Block block);
 
-SG_World World_from_file(const char *world_name);
+void World_fill(World * world, Layer layer, Block block);
 
-void World_write(SG_World * world, const char *world_name);
+void World_clear(World * world);
 
 #endif				// WORLD_H
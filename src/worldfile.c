@@ -0,0 +1,799 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <SM_string.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "worldfile.h"
+
+static const uint8_t PADDING[WORLDFILE_ALIGN] = { 0 };
+
+static uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+static bool write_pad(FILE * f, uint64_t *pos, uint64_t target)
+{
+	while (*pos < target) {
+		size_t n = target - *pos;
+
+		if (n > sizeof(PADDING))
+			n = sizeof(PADDING);
+
+		if (fwrite(PADDING, 1, n, f) != n)
+			return false;
+
+		*pos += n;
+	}
+
+	return true;
+}
+
+/* returns encoded size, or 0 if the encoding would not be smaller */
+static size_t rle_encode(const uint8_t *src, uint8_t *dst)
+{
+	size_t len = 0;
+	size_t run;
+
+	for (size_t i = 0; i < WORLD_CHUNK_BYTES; i += run) {
+		run = 1;
+
+		while (i + run < WORLD_CHUNK_BYTES &&
+		       run < WORLDFILE_RLE_MAX_RUN && src[i + run] == src[i])
+			run++;
+
+		if (len + 2 >= WORLD_CHUNK_BYTES)
+			return 0;
+
+		dst[len++] = run - 1;
+		dst[len++] = src[i];
+	}
+
+	return len;
+}
+
+bool WorldFile_decode_chunk(const uint8_t *src, const WorldFileChunk * chunk,
+			    uint8_t *dst)
+{
+	size_t pos = 0;
+	size_t run;
+
+	switch (chunk->encoding) {
+	case WFE_RAW:
+		if (chunk->size != WORLD_CHUNK_BYTES)
+			return false;
+
+		memcpy(dst, src, WORLD_CHUNK_BYTES);
+		return true;
+
+	case WFE_RLE:
+		if (chunk->size % 2 != 0)
+			return false;
+
+		for (size_t i = 0; i < chunk->size; i += 2) {
+			run = (size_t)src[i] + 1;
+
+			if (pos + run > WORLD_CHUNK_BYTES)
+				return false;
+
+			memset(&dst[pos], src[i + 1], run);
+			pos += run;
+		}
+
+		return pos == WORLD_CHUNK_BYTES;
+	}
+
+	return false;
+}
+
+/* maps the whole file, private and writable, so edits never reach disk */
+static uint8_t *map_file(const char *path, size_t *size)
+{
+	uint8_t *data;
+
+#ifdef _WIN32
+	FILE *f = fopen(path, "rb");
+	long len;
+
+	if (f == NULL)
+		return NULL;
+
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if (len <= 0) {
+		fclose(f);
+		return NULL;
+	}
+
+	data = malloc(len);
+
+	if (data != NULL && fread(data, 1, len, f) != (size_t) len) {
+		free(data);
+		data = NULL;
+	}
+
+	fclose(f);
+	*size = len;
+#else
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+
+	if (fd == -1)
+		return NULL;
+
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return NULL;
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+		    fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return NULL;
+
+	// chunks are touched by locality, not in file order, skip readahead
+	posix_madvise(data, st.st_size, POSIX_MADV_RANDOM);
+	*size = st.st_size;
+#endif
+
+	return data;
+}
+
+/* version 2 headers end before the timestamps, the rest was entity data */
+static void header_upgrade(WorldFileHeader * header)
+{
+	if (header->version != 2)
+		return;
+
+	header->created = 0;
+	header->modified = 0;
+	header->thumb_offset = 0;
+	header->thumb_w = 0;
+	header->thumb_h = 0;
+}
+
+static size_t header_check(const WorldFileHeader * header,
+			   const uint64_t file_size)
+{
+	size_t chunk_count;
+
+	// the other byte order turns version 3 into 0x03000000
+	if (memcmp(header->magic, WORLDFILE_MAGIC, sizeof(header->magic)) !=
+	    0 || header->version < WORLDFILE_VERSION_MIN ||
+	    header->version > WORLDFILE_VERSION ||
+	    header->chunk_size != WORLD_CHUNK_SIZE ||
+	    header->layers != WORLD_LAYERS)
+		return 0;
+
+	if (header->version >= 3 &&
+	    (header->thumb_w != WORLDFILE_THUMB_W ||
+	     header->thumb_h != WORLDFILE_THUMB_H ||
+	     header->thumb_offset > file_size ||
+	     file_size - header->thumb_offset < WORLDFILE_THUMB_BYTES))
+		return 0;
+
+	chunk_count =
+	    ((header->width + WORLD_CHUNK_MASK) >> WORLD_CHUNK_SHIFT) *
+	    ((header->height + WORLD_CHUNK_MASK) >> WORLD_CHUNK_SHIFT);
+
+	if (chunk_count == 0 || header->chunk_count != chunk_count ||
+	    header->ent_offset > file_size ||
+	    (file_size - header->ent_offset) / sizeof(WorldFileEntity) <
+	    header->ent_count || header->dir_offset > file_size ||
+	    (file_size - header->dir_offset) / sizeof(WorldFileChunk) <
+	    chunk_count)
+		return 0;
+
+	return chunk_count;
+}
+
+static void entity_from_record(SG_Entity * ent, const WorldFileEntity * rec)
+{
+	ent->id = rec->id;
+	ent->grounded = rec->grounded;
+	ent->rect.x = rec->x;
+	ent->rect.y = rec->y;
+	ent->rect.w = rec->w;
+	ent->rect.h = rec->h;
+	ent->velocity_x = rec->velocity_x;
+	ent->velocity_y = rec->velocity_y;
+}
+
+static bool write_entities(FILE * f, uint64_t *pos, const World * world)
+{
+	WorldFileEntity ent;
+
+	for (size_t i = 0; i < world->ent_count; i++) {
+		ent.id = world->entities[i].id;
+		ent.grounded = world->entities[i].grounded;
+		ent.x = world->entities[i].rect.x;
+		ent.y = world->entities[i].rect.y;
+		ent.w = world->entities[i].rect.w;
+		ent.h = world->entities[i].rect.h;
+		ent.velocity_x = world->entities[i].velocity_x;
+		ent.velocity_y = world->entities[i].velocity_y;
+
+		if (fwrite(&ent, sizeof(ent), 1, f) != 1)
+			return false;
+
+		*pos += sizeof(ent);
+	}
+
+	return true;
+}
+
+/* samples one tile per cell, blocks first, walls where there is none */
+static void make_thumbnail(const World * world, uint8_t *thumbnail)
+{
+	size_t x, y;
+	Block block;
+
+	for (size_t ty = 0; ty < WORLDFILE_THUMB_H; ty++) {
+		for (size_t tx = 0; tx < WORLDFILE_THUMB_W; tx++) {
+			x = tx * world->width / WORLDFILE_THUMB_W;
+			y = ty * world->height / WORLDFILE_THUMB_H;
+			block = World_get_block(world, x, y, L_BLOCK);
+
+			if (block == B_NONE)
+				block = World_get_block(world, x, y, L_WALL) |
+				    WORLDFILE_THUMB_WALL;
+
+			thumbnail[ty * WORLDFILE_THUMB_W + tx] = block;
+		}
+	}
+}
+
+/* flushes and waits for the data to reach the disk */
+static bool sync_file(FILE * f)
+{
+	if (fflush(f) != 0)
+		return false;
+
+#ifdef _WIN32
+	return true;
+#else
+	return fsync(fileno(f)) == 0;
+#endif
+}
+
+/* writes a chunk at pos, RLE if asked and smaller, and fills its entry */
+static bool write_chunk(FILE * f, uint64_t *pos, const uint8_t *chunk,
+			const bool compress, WorldFileChunk * entry)
+{
+	uint8_t encoded[WORLD_CHUNK_BYTES];
+	size_t len = compress ? rle_encode(chunk, encoded) : 0;
+
+	if (len > 0) {
+		entry->offset = *pos;
+		entry->size = len;
+		entry->encoding = WFE_RLE;
+
+		if (fwrite(encoded, len, 1, f) != 1)
+			return false;
+	} else {
+		if (!write_pad(f, pos, align_up(*pos, WORLDFILE_CHUNK_ALIGN)))
+			return false;
+
+		entry->offset = *pos;
+		entry->size = WORLD_CHUNK_BYTES;
+		entry->encoding = WFE_RAW;
+
+		if (fwrite(chunk, WORLD_CHUNK_BYTES, 1, f) != 1)
+			return false;
+	}
+
+	*pos += entry->size;
+
+	return true;
+}
+
+bool WorldFile_detect(const char *path)
+{
+	char magic[sizeof(WORLDFILE_MAGIC)];
+	FILE *f = fopen(path, "rb");
+	bool result;
+
+	if (f == NULL)
+		return false;
+
+	result = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+	    memcmp(magic, WORLDFILE_MAGIC, sizeof(magic)) == 0;
+
+	fclose(f);
+
+	return result;
+}
+
+World WorldFile_read(const char *path)
+{
+	World world = {.invalid = true };
+	WorldFileHeader header;
+	WorldFileEntity ent;
+	WorldFileChunk chunk;
+	size_t map_size;
+	size_t chunk_count;
+	size_t decoded = 0;
+	uint8_t *map = map_file(path, &map_size);
+
+	if (map == NULL)
+		return world;
+
+	// check header
+	if (map_size < sizeof(header))
+		goto fail;
+
+	memcpy(&header, map, sizeof(header));
+	header_upgrade(&header);
+
+	chunk_count = header_check(&header, map_size);
+
+	if (chunk_count == 0)
+		goto fail;
+
+	world = World_alloc(header.width, header.height, header.ent_count,
+			    false);
+
+	if (world.invalid)
+		goto fail;
+
+	if (header.created != 0)
+		world.created = header.created;
+
+	world.map = map;
+	world.map_size = map_size;
+
+	// entities are small, copy them out
+	for (size_t i = 0; i < header.ent_count; i++) {
+		memcpy(&ent, &map[header.ent_offset + i * sizeof(ent)],
+		       sizeof(ent));
+
+		entity_from_record(&world.entities[i], &ent);
+	}
+
+	// raw chunks stay in the mapping, encoded ones get decoded to heap
+	for (size_t i = 0; i < chunk_count; i++) {
+		memcpy(&chunk, &map[header.dir_offset + i * sizeof(chunk)],
+		       sizeof(chunk));
+
+		if (chunk.offset > map_size || map_size - chunk.offset <
+		    chunk.size)
+			goto fail;
+
+		if (chunk.encoding == WFE_RAW) {
+			if (chunk.size != WORLD_CHUNK_BYTES)
+				goto fail;
+
+			world.chunks[i] = &map[chunk.offset];
+		} else {
+			decoded++;
+		}
+	}
+
+	if (decoded == 0) {
+		World_rebuild_solid(&world);
+		return world;
+	}
+
+	world.chunk_data = malloc(decoded * WORLD_CHUNK_BYTES);
+
+	if (world.chunk_data == NULL)
+		goto fail;
+
+	decoded = 0;
+
+	for (size_t i = 0; i < chunk_count; i++) {
+		if (world.chunks[i] != NULL)
+			continue;
+
+		memcpy(&chunk, &map[header.dir_offset + i * sizeof(chunk)],
+		       sizeof(chunk));
+
+		world.chunks[i] = &world.chunk_data[decoded * WORLD_CHUNK_BYTES];
+		decoded++;
+
+		if (!WorldFile_decode_chunk(&map[chunk.offset], &chunk,
+					    world.chunks[i]))
+			goto fail;
+	}
+
+	World_rebuild_solid(&world);
+	return world;
+
+ fail:
+	world.map = map;
+	world.map_size = map_size;
+	World_clear(&world);
+	world.invalid = true;
+	return world;
+}
+
+/* reads header and thumbnail only, thumbnail is zeroed for version 2 */
+bool WorldFile_describe(const char *path, WorldFileHeader * header,
+			uint8_t *thumbnail)
+{
+	long file_size;
+	bool result = false;
+	FILE *f = fopen(path, "rb");
+
+	if (f == NULL)
+		return false;
+
+	if (fseek(f, 0, SEEK_END) != 0 || (file_size = ftell(f)) < 0 ||
+	    fseek(f, 0, SEEK_SET) != 0 ||
+	    fread(header, sizeof(*header), 1, f) != 1)
+		goto end;
+
+	header_upgrade(header);
+
+	if (header_check(header, file_size) == 0)
+		goto end;
+
+	if (header->version < 3)
+		memset(thumbnail, 0, WORLDFILE_THUMB_BYTES);
+	else if (fseek(f, header->thumb_offset, SEEK_SET) != 0 ||
+		 fread(thumbnail, WORLDFILE_THUMB_BYTES, 1, f) != 1)
+		goto end;
+
+	result = true;
+
+ end:
+	fclose(f);
+	return result;
+}
+
+World WorldFile_open(const char *path, WorldFileChunk ** dir)
+{
+	World world = {.invalid = true };
+	WorldFileHeader header;
+	WorldFileEntity ent;
+	size_t chunk_count;
+	long file_size;
+	FILE *f = fopen(path, "rb");
+
+	*dir = NULL;
+
+	if (f == NULL)
+		return world;
+
+	// check header
+	if (fseek(f, 0, SEEK_END) != 0 || (file_size = ftell(f)) < 0 ||
+	    fseek(f, 0, SEEK_SET) != 0 ||
+	    fread(&header, sizeof(header), 1, f) != 1)
+		goto fail;
+
+	header_upgrade(&header);
+	chunk_count = header_check(&header, file_size);
+
+	if (chunk_count == 0)
+		goto fail;
+
+	world = World_alloc(header.width, header.height, header.ent_count,
+			    false);
+
+	if (world.invalid)
+		goto fail;
+
+	if (header.created != 0)
+		world.created = header.created;
+
+	// entities
+	if (fseek(f, header.ent_offset, SEEK_SET) != 0)
+		goto fail;
+
+	for (size_t i = 0; i < header.ent_count; i++) {
+		if (fread(&ent, sizeof(ent), 1, f) != 1)
+			goto fail;
+
+		entity_from_record(&world.entities[i], &ent);
+	}
+
+	// chunk directory, chunks themselves are left to the caller
+	*dir = malloc(chunk_count * sizeof(WorldFileChunk));
+
+	if (*dir == NULL || fseek(f, header.dir_offset, SEEK_SET) != 0 ||
+	    fread(*dir, sizeof(WorldFileChunk), chunk_count, f) != chunk_count)
+		goto fail;
+
+	for (size_t i = 0; i < chunk_count; i++) {
+		if ((*dir)[i].offset > (uint64_t) file_size ||
+		    (uint64_t) file_size - (*dir)[i].offset < (*dir)[i].size ||
+		    (*dir)[i].size > WORLD_CHUNK_BYTES)
+			goto fail;
+	}
+
+	fclose(f);
+	return world;
+
+ fail:
+	fclose(f);
+	free(*dir);
+	*dir = NULL;
+	World_clear(&world);
+	world.invalid = true;
+	return world;
+}
+
+bool WorldFile_write(World * world, const char *path, const bool compress,
+		     SDL_atomic_t * progress)
+{
+	SM_String tmppath = SM_String_new(8);
+	WorldFileHeader header;
+	WorldFileChunk *dir;
+	const size_t chunk_count = world->chunks_w * world->chunks_h;
+	uint64_t pos = 0;
+	uint8_t raw[WORLD_CHUNK_BYTES];
+	uint8_t thumbnail[WORLDFILE_THUMB_BYTES];
+	bool result = false;
+	FILE *f;
+
+	// fill header
+	memcpy(header.magic, WORLDFILE_MAGIC, sizeof(header.magic));
+	header.version = WORLDFILE_VERSION;
+	header.width = world->width;
+	header.height = world->height;
+	header.chunk_size = WORLD_CHUNK_SIZE;
+	header.layers = WORLD_LAYERS;
+	header.ent_count = world->ent_count;
+	header.chunk_count = chunk_count;
+	header.created = world->created;
+	header.modified = time(NULL);
+	header.thumb_offset = align_up(sizeof(header), 16);
+	header.thumb_w = WORLDFILE_THUMB_W;
+	header.thumb_h = WORLDFILE_THUMB_H;
+	header.ent_offset = align_up(header.thumb_offset +
+				     WORLDFILE_THUMB_BYTES, 16);
+	header.dir_offset = align_up(header.ent_offset +
+				     world->ent_count * sizeof(WorldFileEntity),
+				     16);
+
+	dir = malloc(chunk_count * sizeof(WorldFileChunk));
+
+	if (dir == NULL) {
+		SM_String_clear(&tmppath);
+		return false;
+	}
+
+	/*
+	   Write next to the target and rename over it.
+	   A world mapped from the target keeps its old file alive that way.
+	 */
+	SM_String_copy_cstr(&tmppath, path);
+	SM_String_append_cstr(&tmppath, ".tmp");
+
+	f = fopen(tmppath.str, "wb");
+
+	if (f == NULL) {
+		SM_String_clear(&tmppath);
+		free(dir);
+		return false;
+	}
+
+	if (fwrite(&header, sizeof(header), 1, f) != 1)
+		goto end;
+
+	pos += sizeof(header);
+
+	// thumbnail
+	make_thumbnail(world, thumbnail);
+
+	if (!write_pad(f, &pos, header.thumb_offset) ||
+	    fwrite(thumbnail, sizeof(thumbnail), 1, f) != 1)
+		goto end;
+
+	pos += sizeof(thumbnail);
+
+	// entities
+	if (!write_pad(f, &pos, header.ent_offset))
+		goto end;
+
+	if (!write_entities(f, &pos, world))
+		goto end;
+
+	// chunks, the directory is filled on the way and written last
+	if (!write_pad(f, &pos, align_up(header.dir_offset +
+					 chunk_count * sizeof(WorldFileChunk),
+					 WORLDFILE_ALIGN)))
+		goto end;
+
+	for (size_t i = 0; i < chunk_count; i++) {
+		if (!write_chunk(f, &pos, World_chunk_raw(world, i, raw),
+				 compress, &dir[i]))
+			goto end;
+
+		if (progress != NULL)
+			SDL_AtomicSet(progress, (i + 1) * 1000 / chunk_count);
+	}
+
+	// chunk directory
+	if (fseek(f, header.dir_offset, SEEK_SET) != 0 ||
+	    fwrite(dir, sizeof(WorldFileChunk), chunk_count, f) != chunk_count)
+		goto end;
+
+	if (!sync_file(f))
+		goto end;
+
+	result = true;
+
+ end:
+	if (fclose(f) != 0)
+		result = false;
+
+	if (result) {
+#ifdef _WIN32
+		remove(path);
+#endif
+		result = rename(tmppath.str, path) == 0;
+	}
+
+	if (!result)
+		remove(tmppath.str);
+
+	SM_String_clear(&tmppath);
+	free(dir);
+	return result;
+}
+
+bool WorldFile_write_dirty(World * world, const char *path,
+			   const bool compress, SDL_atomic_t * progress)
+{
+	WorldFileHeader header;
+	WorldFileChunk *dir = NULL;
+	const size_t chunk_count = world->chunks_w * world->chunks_h;
+	uint64_t live;
+	uint64_t pos;
+	size_t written = 0;
+	uint8_t raw[WORLD_CHUNK_BYTES];
+	uint8_t thumbnail[WORLDFILE_THUMB_BYTES];
+	long file_size;
+	bool result = false;
+	FILE *f = fopen(path, "r+b");
+
+	if (f == NULL)
+		return WorldFile_write(world, path, compress, progress);
+
+	// the file has to be the one this world was loaded from
+	if (fseek(f, 0, SEEK_END) != 0 || (file_size = ftell(f)) < 0 ||
+	    fseek(f, 0, SEEK_SET) != 0 ||
+	    fread(&header, sizeof(header), 1, f) != 1 ||
+	    header.version != WORLDFILE_VERSION ||
+	    header_check(&header, file_size) != chunk_count ||
+	    header.created != world->created ||
+	    header.width != world->width || header.height != world->height ||
+	    header.ent_count != world->ent_count)
+		goto full;
+
+	dir = malloc(chunk_count * sizeof(WorldFileChunk));
+
+	if (dir == NULL || fseek(f, header.dir_offset, SEEK_SET) != 0 ||
+	    fread(dir, sizeof(WorldFileChunk), chunk_count, f) != chunk_count)
+		goto full;
+
+	// compact with a full rewrite once stale chunks outweigh live data
+	live = align_up(header.dir_offset +
+			chunk_count * sizeof(WorldFileChunk), WORLDFILE_ALIGN);
+
+	for (size_t i = 0; i < chunk_count; i++)
+		live += dir[i].size;
+
+	if ((uint64_t) file_size - live > live)
+		goto full;
+
+	/*
+	   Changed chunks are appended, old copies stay untouched.
+	   Entries only point at the new copies once all of them are written.
+	 */
+	if (fseek(f, 0, SEEK_END) != 0)
+		goto end;
+
+	pos = file_size;
+
+	for (size_t i = 0; i < chunk_count; i++) {
+		if (!(world->flags[i] & CF_DIRTY))
+			continue;
+
+		if (!write_chunk(f, &pos, World_chunk_raw(world, i, raw),
+				 compress, &dir[i]))
+			goto end;
+
+		written++;
+
+		if (progress != NULL)
+			SDL_AtomicSet(progress,
+				      written * 1000 / world->dirty_count);
+	}
+
+	if (!sync_file(f))
+		goto end;
+
+	for (size_t i = 0; i < chunk_count; i++) {
+		if (!(world->flags[i] & CF_DIRTY))
+			continue;
+
+		if (fseek(f, header.dir_offset + i * sizeof(WorldFileChunk),
+			  SEEK_SET) != 0 ||
+		    fwrite(&dir[i], sizeof(WorldFileChunk), 1, f) != 1)
+			goto end;
+	}
+
+	// entities are tiny, always rewritten in place
+	pos = header.ent_offset;
+
+	if (fseek(f, header.ent_offset, SEEK_SET) != 0 ||
+	    !write_entities(f, &pos, world))
+		goto end;
+
+	// so are thumbnail and header
+	make_thumbnail(world, thumbnail);
+	header.modified = time(NULL);
+
+	if (fseek(f, header.thumb_offset, SEEK_SET) != 0 ||
+	    fwrite(thumbnail, sizeof(thumbnail), 1, f) != 1 ||
+	    fseek(f, 0, SEEK_SET) != 0 ||
+	    fwrite(&header, sizeof(header), 1, f) != 1)
+		goto end;
+
+	if (!sync_file(f))
+		goto end;
+
+	result = true;
+
+ end:
+	if (fclose(f) != 0)
+		result = false;
+
+	free(dir);
+	return result;
+
+ full:
+	fclose(f);
+	free(dir);
+	return WorldFile_write(world, path, compress, progress);
+}
+
+void WorldFile_unmap(World * world)
+{
+	if (world->map == NULL)
+		return;
+
+#ifdef _WIN32
+	free(world->map);
+#else
+	munmap(world->map, world->map_size);
+#endif
+
+	world->map = NULL;
+	world->map_size = 0;
+}
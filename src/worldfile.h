@@ -0,0 +1,125 @@
+/*
+ * 2d_platformer
+ * Copyright (C) 2022  Andy Frank Schoknecht
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not see
+ * <https://www.gnu.org/licenses/old-licenses/gpl-2.0.html>.
+ */
+
+#ifndef WORLDFILE_H
+#define WORLDFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <SDL_atomic.h>
+#include "world.h"
+
+/*
+	World file, version 3. Values are stored in the native byte order
+	of the machine that wrote the file, the structs below are written
+	as they are. A file from a machine of the other byte order reads
+	back with a byte swapped version and is rejected (see header_check).
+
+	[header][thumbnail][entity records][chunk directory]
+	[pad to WORLDFILE_ALIGN][chunk 0][chunk 1]...
+
+	Header and thumbnail sit at the start, so a world is described
+	without touching its chunks (see catalog.h). The thumbnail holds one
+	block id per cell, walls with WORLDFILE_THUMB_WALL set. Version 2
+	files lack timestamps and thumbnail and are upgraded on their next
+	save.
+
+	Raw chunks have the exact in-memory layout of a World chunk, so the
+	file is mapped and its chunks are used as block storage directly.
+	RLE chunks are (run length - 1, block) byte pairs covering all planes
+	of the chunk and are decoded one by one through the directory.
+
+	Saves of a few changed chunks append them to the end of the file and
+	repoint their directory entries, stale copies are dropped by the next
+	full write.
+*/
+#define WORLDFILE_VERSION 3
+#define WORLDFILE_VERSION_MIN 2
+#define WORLDFILE_ALIGN 4096
+#define WORLDFILE_CHUNK_ALIGN 64
+#define WORLDFILE_RLE_MAX_RUN 256
+#define WORLDFILE_THUMB_W 64
+#define WORLDFILE_THUMB_H 32
+#define WORLDFILE_THUMB_BYTES (WORLDFILE_THUMB_W * WORLDFILE_THUMB_H)
+#define WORLDFILE_THUMB_WALL 0x80
+
+static const char WORLDFILE_MAGIC[4] = { '2', 'D', 'W', 'L' };
+
+typedef enum WorldFileEncoding {
+	WFE_RAW,
+	WFE_RLE,
+} WorldFileEncoding;
+
+typedef struct WorldFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t chunk_size;
+	uint32_t layers;
+	uint32_t ent_count;
+	uint32_t chunk_count;
+	uint64_t ent_offset;
+	uint64_t dir_offset;
+	/* version 3 */
+	int64_t created;	/* unix time */
+	int64_t modified;
+	uint64_t thumb_offset;
+	uint32_t thumb_w;
+	uint32_t thumb_h;
+} WorldFileHeader;
+
+typedef struct WorldFileEntity {
+	uint32_t id;
+	uint32_t grounded;
+	float x;
+	float y;
+	float w;
+	float h;
+	float velocity_x;
+	float velocity_y;
+} WorldFileEntity;
+
+typedef struct WorldFileChunk {
+	uint64_t offset;
+	uint32_t size;
+	uint32_t encoding;
+} WorldFileChunk;
+
+bool WorldFile_detect(const char *path);
+
+World WorldFile_read(const char *path);
+
+bool WorldFile_describe(const char *path, WorldFileHeader * header,
+			uint8_t *thumbnail);
+
+World WorldFile_open(const char *path, WorldFileChunk ** dir);
+
+bool WorldFile_decode_chunk(const uint8_t *src, const WorldFileChunk * chunk,
+			    uint8_t *dst);
+
+bool WorldFile_write(World * world, const char *path, const bool compress,
+		     SDL_atomic_t * progress);
+
+bool WorldFile_write_dirty(World * world, const char *path,
+			   const bool compress, SDL_atomic_t * progress);
+
+void WorldFile_unmap(World * world);
+
+#endif				// WORLDFILE_H